@@ -0,0 +1,328 @@
+#include "BatchTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctype.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <lsl_cpp.h>
+#include "Options.h"
+#include "RecordingStreamer.h"
+#include "StopSignal.h"
+
+typedef enum
+{
+    BATCH_FILE_PENDING = 0,
+    BATCH_FILE_RUNNING,
+    BATCH_FILE_DONE,
+    BATCH_FILE_FAILED,
+    BATCH_FILE_SKIPPED, // Its output exists from an earlier run
+    BATCH_FILE_COUNT
+} batch_file_state_t;
+
+struct BatchFile
+{
+    std::string path;
+    std::string output;
+    uintmax_t bytes = 0;
+    std::atomic<int> state{ BATCH_FILE_PENDING };
+    RecordingProgress progress;
+};
+
+// Throughput while a given number of workers were busy, summed over the report intervals
+struct ScalingSample
+{
+    uint64_t frames = 0;
+    double seconds = 0;
+};
+
+// Worker completion lines and the periodic report must not interleave
+static std::mutex g_batchReportMutex;
+
+static bool IsRecording(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return extension == ".mkv";
+}
+
+bool ListRecordings(const char* path, std::vector<std::string>& recordings)
+{
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error))
+    {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(path, error))
+        {
+            if (entry.is_regular_file(error) && IsRecording(entry.path()))
+            {
+                recordings.push_back(entry.path().string());
+            }
+        }
+    }
+    else
+    {
+        std::ifstream list(path);
+        if (!list)
+        {
+            printf("Cannot read %s\n", path);
+            return false;
+        }
+        std::string line;
+        while (std::getline(list, line))
+        {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+            {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] != '#')
+            {
+                recordings.push_back(line);
+            }
+        }
+    }
+    if (error)
+    {
+        printf("Cannot list %s: %s\n", path, error.message().c_str());
+        return false;
+    }
+    if (recordings.empty())
+    {
+        printf("No recordings in %s\n", path);
+        return false;
+    }
+    std::sort(recordings.begin(), recordings.end());
+    return true;
+}
+
+static void PrintDuration(const char* label, double seconds)
+{
+    int total = (int)seconds;
+    printf("%s%dh %02dm %02ds", label, total / 3600, total / 60 % 60, total % 60);
+}
+
+int TrackBatch(const std::vector<std::string>& recordings, const char* output_dir, const StreamerOptions& options)
+{
+    const size_t file_count = recordings.size();
+    std::unique_ptr<BatchFile[]> files(new BatchFile[file_count]);
+    for (size_t i = 0; i < file_count; i++)
+    {
+        std::filesystem::path path(recordings[i]);
+        std::filesystem::path output = output_dir != NULL ? std::filesystem::path(output_dir) / path.filename() : path;
+        files[i].path = recordings[i];
+        files[i].output = output.replace_extension(".csv").string();
+        std::error_code error;
+        files[i].bytes = std::filesystem::file_size(path, error);
+        if (error)
+        {
+            files[i].bytes = 0; // Fails with a proper message when it is opened
+        }
+    }
+    if (output_dir != NULL)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(output_dir, error);
+        if (error)
+        {
+            printf("Cannot create %s: %s\n", output_dir, error.message().c_str());
+            return -1;
+        }
+    }
+
+    // Largest first: the file that takes longest starts earliest, so the workers finish together
+    std::vector<size_t> order(file_count);
+    for (size_t i = 0; i < file_count; i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return files[a].bytes > files[b].bytes; });
+
+    // The workers report per file; the batch prints its own progress instead of every pipeline's
+    StreamerOptions file_options = options;
+    file_options.pipeline.quiet = true;
+    file_options.pipeline.stats_interval_s = 0;
+
+    const int worker_count = (int)std::min<size_t>(std::max(options.batch_workers, 1), file_count);
+    printf("Tracking %zu recordings on %d workers, one CPU tracker each\n", file_count, worker_count);
+
+    std::atomic<size_t> next_file{ 0 };
+    std::atomic<size_t> finished_files{ 0 };
+    std::atomic<int> busy_workers{ 0 };
+    std::atomic<int> running_workers{ worker_count };
+    const double started = lsl_local_clock();
+
+    auto worker = [&](int index)
+    {
+        // Staggered starts, so the throughput of every worker count gets measured. A worker that
+        // would start after the last file has been handed out gives up waiting.
+        const double start_at = started + (double)index * options.batch_ramp_s;
+        while (lsl_local_clock() < start_at && !IsStopRequested() && next_file < file_count)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        while (!IsStopRequested())
+        {
+            const size_t position = next_file++;
+            if (position >= file_count)
+            {
+                break;
+            }
+            BatchFile& file = files[order[position]];
+            std::error_code error;
+            if (std::filesystem::exists(file.output, error))
+            {
+                file.state = BATCH_FILE_SKIPPED;
+            }
+            else
+            {
+                file.state = BATCH_FILE_RUNNING;
+                busy_workers++;
+                const std::string part = file.output + ".part";
+                int result = StreamRecording(file.path.c_str(), part.c_str(), file_options, true, &file.progress);
+                busy_workers--;
+
+                // A stop ends the pipeline cleanly, but the file is not complete. Incomplete output is
+                // removed, and an interrupted file counts as not started, for the next run to redo.
+                const bool interrupted = IsStopRequested();
+                if (result == 0 && !interrupted)
+                {
+                    std::filesystem::rename(part, file.output, error);
+                    result = error ? -1 : 0;
+                }
+                if (result != 0 || interrupted)
+                {
+                    std::filesystem::remove(part, error);
+                }
+                file.state = interrupted ? BATCH_FILE_PENDING : result == 0 ? BATCH_FILE_DONE : BATCH_FILE_FAILED;
+            }
+
+            const size_t finished = ++finished_files;
+            std::lock_guard<std::mutex> lock(g_batchReportMutex);
+            if (file.state == BATCH_FILE_SKIPPED)
+            {
+                printf("[%zu/%zu] %s: skipped, %s exists\n", finished, file_count, file.path.c_str(), file.output.c_str());
+            }
+            else if (file.state == BATCH_FILE_DONE)
+            {
+                const double elapsed = file.progress.elapsed_s;
+                printf("[%zu/%zu] %s: %llu frames in %.1f s, %.1f fps, %.2fx real time\n", finished, file_count, file.path.c_str(),
+                    (unsigned long long)file.progress.frames, elapsed, elapsed > 0 ? file.progress.frames / elapsed : 0.0,
+                    elapsed > 0 ? file.progress.length_s / elapsed : 0.0);
+            }
+            else if (file.state == BATCH_FILE_FAILED)
+            {
+                printf("[%zu/%zu] %s: failed\n", finished, file_count, file.path.c_str());
+            }
+            else
+            {
+                printf("[%zu/%zu] %s: interrupted\n", finished, file_count, file.path.c_str());
+            }
+        }
+        running_workers--;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(worker_count);
+    for (int i = 0; i < worker_count; i++)
+    {
+        threads.emplace_back(worker, i);
+    }
+
+    // Every report interval: throughput, and how far each running file has got. Between reports
+    // every short tick counts towards the scaling of n workers if n were busy at both its ends.
+    std::vector<ScalingSample> scaling(worker_count + 1);
+    uint64_t tick_frames = 0;
+    double tick_time = started;
+    int tick_busy = 0;
+    uint64_t report_frames = 0;
+    double last_report = started;
+    while (running_workers > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const double now = lsl_local_clock();
+        const int busy = busy_workers;
+        uint64_t frames = 0;
+        for (size_t i = 0; i < file_count; i++)
+        {
+            frames += files[i].progress.frames;
+        }
+        if (busy == tick_busy && busy > 0)
+        {
+            scaling[busy].frames += frames - tick_frames;
+            scaling[busy].seconds += now - tick_time;
+        }
+        tick_frames = frames;
+        tick_time = now;
+        tick_busy = busy;
+
+        const double interval = now - last_report;
+        if (interval < BATCH_REPORT_INTERVAL_S || running_workers == 0)
+        {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(g_batchReportMutex);
+        printf("Batch: %zu/%zu files finished, %llu frames, %.1f fps over the last %.0f s, %d workers busy\n",
+            (size_t)finished_files, file_count, (unsigned long long)frames, (frames - report_frames) / interval, interval, busy);
+        for (size_t i = 0; i < file_count; i++)
+        {
+            const BatchFile& file = files[i];
+            const uint64_t expected = file.progress.expected_frames;
+            if (file.state == BATCH_FILE_RUNNING && expected > 0)
+            {
+                printf("  %s: %3.0f%% (%llu of about %llu frames)\n", file.path.c_str(),
+                    std::min(100.0, 100.0 * file.progress.frames / expected), (unsigned long long)file.progress.frames,
+                    (unsigned long long)expected);
+            }
+        }
+        report_frames = frames;
+        last_report = now;
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Summary: totals, then frames/s per busy worker count against one worker
+    const double elapsed = lsl_local_clock() - started;
+    size_t counts[BATCH_FILE_COUNT] = {};
+    uint64_t frames = 0;
+    double recorded_s = 0;
+    for (size_t i = 0; i < file_count; i++)
+    {
+        counts[files[i].state]++;
+        frames += files[i].progress.frames;
+        recorded_s += files[i].state == BATCH_FILE_DONE ? files[i].progress.length_s : 0.0;
+    }
+    PrintDuration("Batch summary (", elapsed);
+    printf("): %zu tracked, %zu skipped, %zu failed, %zu not started\n", counts[BATCH_FILE_DONE], counts[BATCH_FILE_SKIPPED],
+        counts[BATCH_FILE_FAILED], counts[BATCH_FILE_PENDING]);
+    printf("  %llu frames, %.1f fps aggregate, %.2fx real time\n", (unsigned long long)frames, elapsed > 0 ? frames / elapsed : 0.0,
+        elapsed > 0 ? recorded_s / elapsed : 0.0);
+    const double single_fps = scaling[1].seconds > 0 ? scaling[1].frames / scaling[1].seconds : 0.0;
+    printf("  workers busy      fps  per worker  efficiency  measured\n");
+    for (int busy = 1; busy <= worker_count; busy++)
+    {
+        if (scaling[busy].seconds <= 0)
+        {
+            continue;
+        }
+        const double fps = scaling[busy].frames / scaling[busy].seconds;
+        printf("  %12d %8.1f %11.1f", busy, fps, fps / busy);
+        if (single_fps > 0)
+        {
+            printf(" %10.0f%%", 100.0 * fps / (busy * single_fps));
+        }
+        else
+        {
+            printf(" %11s", "-");
+        }
+        PrintDuration("  ", scaling[busy].seconds);
+        printf("\n");
+    }
+    return counts[BATCH_FILE_FAILED] == 0 && counts[BATCH_FILE_PENDING] == 0 && counts[BATCH_FILE_RUNNING] == 0 ? 0 : -1;
+}
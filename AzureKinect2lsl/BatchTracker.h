@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct StreamerOptions;
+
+#define BATCH_REPORT_INTERVAL_S 10 // Progress and throughput are printed this often
+#define BATCH_DEFAULT_RAMP_S 60    // Seconds between starting one worker and the next
+
+/**
+ * Collects the recordings of a batch: every .mkv file in a directory, or every line of a list file
+ * (blank lines and lines starting with # skipped). Prints the problem and returns false if the path
+ * cannot be read or holds no recordings.
+ */
+bool ListRecordings(const char* path, std::vector<std::string>& recordings);
+
+/**
+ * Re-tracks every recording of the batch with StreamRecording on options.batch_workers threads, each
+ * file with a CPU tracker of its own, into <output_dir>/<name>.csv, or next to the recording without
+ * an output_dir. Files are handed out largest first, so a long recording does not end up running
+ * alone at the end. A file is written under a .part name and renamed once it is complete, and
+ * recordings whose output already exists are skipped, so an interrupted batch picks up where it stopped.
+ * Workers start options.batch_ramp_s apart, and the throughput measured while n workers were busy
+ * gives the scaling efficiency against one worker, printed with the batch summary.
+ * Returns 0 if every file was tracked or skipped, -1 otherwise.
+ */
+int TrackBatch(const std::vector<std::string>& recordings, const char* output_dir, const StreamerOptions& options);
@@ -0,0 +1,817 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "BodyIndexStream.h"
+#include "BodyPointCloud.h"
+#include "BoneLengthFilter.h"
+#include "FrameSetAssembler.h"
+#include "JointSmoothing.h"
+#include "PrimarySelector.h"
+#include "SkeletonFusion.h"
+#include "SkeletonPacker.h"
+
+// Skeletons with distinct, deterministic values in every field
+static std::vector<k4abt_skeleton_t> MakeSyntheticSkeletons(size_t count)
+{
+    std::vector<k4abt_skeleton_t> skeletons(count);
+    uint32_t seed = 12345;
+    for (k4abt_skeleton_t& skeleton : skeletons)
+    {
+        for (k4abt_joint_t& joint : skeleton.joints)
+        {
+            for (float& v : joint.position.v)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                v = (float)(seed >> 8) / 16777216.0f * 2000.0f - 1000.0f;
+            }
+            for (float& v : joint.orientation.v)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                v = (float)(seed >> 8) / 16777216.0f * 2.0f - 1.0f;
+            }
+            joint.confidence_level = K4ABT_JOINT_CONFIDENCE_MEDIUM;
+        }
+    }
+    return skeletons;
+}
+
+// Packs every skeleton repeatedly and returns the mean cost of one skeleton in nanoseconds
+template <typename PackFunction>
+static double TimePacking(PackFunction pack, const std::vector<k4abt_skeleton_t>& skeletons, float* data, int rounds, float* checksum)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        for (size_t i = 0; i < skeletons.size(); i++)
+        {
+            pack(skeletons[i], data + i * g_skeletonChannelCount);
+        }
+        *checksum += data[round % (skeletons.size() * g_skeletonChannelCount)];
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ((double)rounds * skeletons.size());
+}
+
+static int RunPackBenchmark()
+{
+    const size_t body_count = 6;
+    const int rounds = 200000;
+
+    std::vector<k4abt_skeleton_t> skeletons = MakeSyntheticSkeletons(body_count);
+    std::vector<float> scalar_data(body_count * g_skeletonChannelCount);
+    std::vector<float> kernel_data(body_count * g_skeletonChannelCount);
+
+    float checksum = 0;
+    double scalar_ns = TimePacking(PackSkeletonScalar, skeletons, scalar_data.data(), rounds, &checksum);
+    double kernel_ns = TimePacking(PackSkeleton, skeletons, kernel_data.data(), rounds, &checksum);
+
+    if (memcmp(scalar_data.data(), kernel_data.data(), scalar_data.size() * sizeof(float)) != 0)
+    {
+        printf("Pack benchmark: %s kernel output differs from the scalar packer!\n", GetPackKernelName());
+        return 1;
+    }
+
+    printf("Pack benchmark (%zu bodies per frame, %d frames, checksum %g)\n", body_count, rounds, checksum);
+    printf("  scalar: %7.1f ns per skeleton, %8.1f ns per frame\n", scalar_ns, scalar_ns * body_count);
+    printf("  %-6s: %7.1f ns per skeleton, %8.1f ns per frame\n", GetPackKernelName(), kernel_ns, kernel_ns * body_count);
+    return 0;
+}
+
+// Times the primary-subject selection for every mode on a crowded frame
+static int RunSelectBenchmark()
+{
+    const size_t body_count = 6;
+    const int rounds = 200000;
+
+    std::vector<k4abt_skeleton_t> skeletons = MakeSyntheticSkeletons(body_count);
+    uint32_t body_ids[body_count];
+    for (size_t i = 0; i < body_count; i++)
+    {
+        body_ids[i] = (uint32_t)i + 1;
+        skeletons[i].joints[K4ABT_JOINT_PELVIS].position.xyz.z = 1000.0f + 400.0f * i;
+    }
+
+    printf("Primary selection benchmark (%zu bodies per frame, %d frames)\n", body_count, rounds);
+    for (int selection = PRIMARY_SELECTION_OFF + 1; selection < PRIMARY_SELECTION_COUNT; selection++)
+    {
+        PrimarySelector selector((primary_selection_t)selection, SelectionVolume());
+        int checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            checksum += selector.Select(body_ids, skeletons.data(), body_count);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double frame_ns = std::chrono::duration<double, std::nano>(elapsed).count() / rounds;
+        printf("  %-10s: %7.1f ns per frame (checksum %d)\n", GetPrimarySelectionName((primary_selection_t)selection), frame_ns, checksum);
+    }
+    return 0;
+}
+
+// NFOV 2x2 binned body index map: background with two upright ellipses as people, each with a
+// ragged silhouette edge
+static std::vector<uint8_t> MakeSyntheticBodyIndexMap(int width, int height)
+{
+    std::vector<uint8_t> map((size_t)width * height, K4ABT_BODY_INDEX_MAP_BACKGROUND);
+    uint32_t seed = 12345;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            float jitter = (float)(seed >> 24) / 256.0f * 0.1f;
+            float a = (x - 100) / 45.0f, b = (y - 150) / 120.0f;
+            float c = (x - 220) / 40.0f, d = (y - 160) / 110.0f;
+            if (a * a + b * b < 1.0f + jitter)
+            {
+                map[(size_t)y * width + x] = 0;
+            }
+            else if (c * c + d * d < 1.0f + jitter)
+            {
+                map[(size_t)y * width + x] = 1;
+            }
+        }
+    }
+    return map;
+}
+
+// Times the body index map encoders on a map with two people in view
+static int RunRleBenchmark()
+{
+    const int width = 320;
+    const int height = 288;
+    const int rounds = 20000;
+
+    std::vector<uint8_t> map = MakeSyntheticBodyIndexMap(width, height);
+
+    std::vector<uint8_t> scalar_data(GetBodyIndexEncodedCapacity(width, height));
+    std::vector<uint8_t> kernel_data(GetBodyIndexEncodedCapacity(width, height));
+    size_t scalar_size = 0;
+    size_t kernel_size = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        scalar_size = EncodeBodyIndexMapScalar(map.data(), width, height, width, scalar_data.data());
+    }
+    double scalar_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        kernel_size = EncodeBodyIndexMap(map.data(), width, height, width, kernel_data.data());
+    }
+    double kernel_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    if (scalar_size != kernel_size || memcmp(scalar_data.data(), kernel_data.data(), scalar_size) != 0)
+    {
+        printf("RLE benchmark: %s kernel output differs from the scalar encoder!\n", GetRunFinderKernelName());
+        return 1;
+    }
+
+    printf("Body index RLE benchmark (%dx%d map, %d frames)\n", width, height, rounds);
+    printf("  %zu bytes -> %zu bytes, %.1fx smaller\n", map.size(), kernel_size, (double)map.size() / kernel_size);
+    printf("  scalar: %7.2f us per map\n", scalar_us);
+    printf("  %-6s: %7.2f us per map\n", GetRunFinderKernelName(), kernel_us);
+    return 0;
+}
+
+// Times point cloud extraction for two people at 2-3 m, with a pinhole xy table in place of the
+// device calibration
+static int RunCloudBenchmark()
+{
+    const int width = 320;
+    const int height = 288;
+    const int rounds = 2000;
+    const float focal_length = 252.0f; // NFOV 2x2 binned, roughly
+
+    std::vector<k4a_float2_t> xy_table((size_t)width * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            xy_table[(size_t)y * width + x].xy.x = (x - width * 0.5f) / focal_length;
+            xy_table[(size_t)y * width + x].xy.y = (y - height * 0.5f) / focal_length;
+        }
+    }
+    std::vector<uint8_t> map = MakeSyntheticBodyIndexMap(width, height);
+    // Each body a rounded surface facing the camera
+    std::vector<uint16_t> depth((size_t)width * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            size_t i = (size_t)y * width + x;
+            depth[i] = (uint16_t)(map[i] == 0 ? 2000 + (x - 100) * (x - 100) / 10 : 2600 + (x - 220) * (x - 220) / 10);
+        }
+    }
+    const uint32_t body_ids[] = { 7, 9 };
+
+    printf("Point cloud benchmark (%dx%d, two bodies, %d frames)\n", width, height, rounds);
+    const int voxel_sizes[] = { 10, 20, 40 };
+    for (int voxel_mm : voxel_sizes)
+    {
+        BodyPointCloud cloud(width, height, xy_table, (float)voxel_mm);
+        std::vector<float> points(MAX_CLOUD_VOXELS * POINT_CLOUD_CHANNEL_COUNT);
+        size_t count = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            count = cloud.Extract(depth.data(), width * sizeof(uint16_t), map.data(), width, body_ids, 2, points.data());
+        }
+        double frame_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+        printf("  %2d mm voxels: %7.1f us per frame, %zu points\n", voxel_mm, frame_us, count);
+    }
+    return 0;
+}
+
+// Reach-and-hold trajectory for the smoothing benchmark: rest at 0, a minimum-jerk move to 300 mm
+// along x, rest, and back, sampled at 30 fps with Gaussian noise. Returns the true and noisy x.
+static void MakeSyntheticReaches(int reaches, double frame_s, double move_s, double hold_s,
+    std::vector<float>* truth, std::vector<float>* noisy)
+{
+    const double period = 2 * (move_s + hold_s);
+    const int frames = (int)(reaches * period / frame_s);
+    uint32_t seed = 12345;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        double t = fmod(frame * frame_s, period);
+        double x = 0;
+        if (t < hold_s)
+        {
+            x = 0;
+        }
+        else if (t < hold_s + move_s)
+        {
+            double s = (t - hold_s) / move_s;
+            x = 300 * s * s * s * (10 - 15 * s + 6 * s * s);
+        }
+        else if (t < 2 * hold_s + move_s)
+        {
+            x = 300;
+        }
+        else
+        {
+            double s = (t - 2 * hold_s - move_s) / move_s;
+            x = 300 - 300 * s * s * s * (10 - 15 * s + 6 * s * s);
+        }
+        // Box-Muller on two uniform draws, 4 mm standard deviation
+        seed = seed * 1664525u + 1013904223u;
+        double u1 = ((seed >> 8) + 1.0) / 16777217.0;
+        seed = seed * 1664525u + 1013904223u;
+        double u2 = (seed >> 8) / 16777216.0;
+        truth->push_back((float)x);
+        noisy->push_back((float)(x + 4.0 * sqrt(-2.0 * log(u1)) * cos(6.283185307 * u2)));
+    }
+}
+
+// Jitter is the RMS error over the second half of every hold; lag is how much later than the true
+// motion the filtered x crosses 150 mm, averaged over every move
+static void MeasureLagAndJitter(const std::vector<float>& truth, const std::vector<float>& filtered, double frame_s,
+    double move_s, double hold_s, double* jitter_mm, double* lag_ms)
+{
+    const double period = 2 * (move_s + hold_s);
+    double squared_error = 0;
+    int held = 0;
+    double lag = 0;
+    int moves = 0;
+    for (size_t frame = 1; frame < truth.size(); frame++)
+    {
+        double t = fmod(frame * frame_s, period);
+        bool late_in_hold = (t >= hold_s / 2 && t < hold_s) || (t >= move_s + 1.5 * hold_s && t < move_s + 2 * hold_s);
+        if (late_in_hold)
+        {
+            squared_error += (filtered[frame] - truth[frame]) * (filtered[frame] - truth[frame]);
+            held++;
+        }
+        // The true crossing is half way through the move; interpolate the filtered one between frames
+        float before = filtered[frame - 1] - 150.0f, after = filtered[frame] - 150.0f;
+        if ((before < 0) != (after < 0))
+        {
+            double crossed = (frame - 1 + before / (before - after)) * frame_s;
+            double move_start = fmod(crossed, period) < hold_s + move_s + hold_s ? hold_s : 2 * hold_s + move_s;
+            lag += fmod(crossed, period) - (move_start + move_s / 2);
+            moves++;
+        }
+    }
+    *jitter_mm = held > 0 ? sqrt(squared_error / held) : 0;
+    *lag_ms = moves > 0 ? lag / moves * 1000 : 0;
+}
+
+// Times the joint smoother and compares its lag and jitter on noisy reaches against exponential
+// smoothing, the model used here for the tracker's temporal_smoothing factor
+static int RunSmoothBenchmark()
+{
+    const size_t body_count = 6;
+    const int rounds = 100000;
+    const uint64_t frame_usec = 33333;
+
+    // A cycle of frames with tracker-like jitter on every value, so the filter state never settles
+    const size_t cycle = 64;
+    std::vector<k4abt_skeleton_t> skeletons = MakeSyntheticSkeletons(body_count);
+    std::vector<float> joints(cycle * body_count * g_skeletonChannelCount);
+    std::vector<float> smoothed(body_count * g_skeletonChannelCount);
+    uint32_t seed = 12345;
+    for (size_t frame = 0; frame < cycle; frame++)
+    {
+        for (size_t i = 0; i < body_count; i++)
+        {
+            float* packed = joints.data() + (frame * body_count + i) * g_skeletonChannelCount;
+            PackSkeletonScalar(skeletons[i], packed);
+            for (int channel = 0; channel < g_skeletonChannelCount; channel++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                float jitter = (float)(seed >> 8) / 16777216.0f - 0.5f;
+                packed[channel] += channel % g_channelsPerJoint < 3 ? 10.0f * jitter : 0.02f * jitter;
+            }
+        }
+    }
+    SmoothingConfig config;
+    JointSmoother smoother((int)body_count, config);
+    float checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        const float* frame = joints.data() + (round % cycle) * body_count * g_skeletonChannelCount;
+        for (size_t i = 0; i < body_count; i++)
+        {
+            smoother.Apply((int)i, (uint32_t)i + 1, frame + i * g_skeletonChannelCount, (round + 1) * frame_usec,
+                smoothed.data() + i * g_skeletonChannelCount);
+        }
+        checksum += smoothed[round % smoothed.size()];
+    }
+    double body_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ((double)rounds * body_count);
+
+    printf("Smoothing benchmark (%zu bodies per frame, %d frames, checksum %g)\n", body_count, rounds, checksum);
+    printf("  one-euro: %7.1f ns per skeleton, %8.1f ns per frame\n", body_ns, body_ns * body_count);
+
+    // Lag and jitter on one joint reaching back and forth with 4 mm of noise
+    const double frame_s = frame_usec * 1e-6, move_s = 0.5, hold_s = 1.0;
+    std::vector<float> truth, noisy;
+    MakeSyntheticReaches(20, frame_s, move_s, hold_s, &truth, &noisy);
+    printf("  %zu frames of 300 mm reaches, 4 mm noise:\n", truth.size());
+    printf("  %-22s %9s %9s\n", "filter", "jitter mm", "lag ms");
+
+    double jitter, lag;
+    MeasureLagAndJitter(truth, noisy, frame_s, move_s, hold_s, &jitter, &lag);
+    printf("  %-22s %9.2f %9.1f\n", "raw", jitter, lag);
+
+    const float sdk_factors[] = { 0.3f, 0.6f, 0.9f };
+    for (float factor : sdk_factors)
+    {
+        std::vector<float> filtered(noisy.size());
+        float state = noisy[0];
+        for (size_t frame = 0; frame < noisy.size(); frame++)
+        {
+            state = factor * state + (1.0f - factor) * noisy[frame];
+            filtered[frame] = state;
+        }
+        MeasureLagAndJitter(truth, filtered, frame_s, move_s, hold_s, &jitter, &lag);
+        char name[32];
+        snprintf(name, sizeof(name), "sdk model %.1f", factor);
+        printf("  %-22s %9.2f %9.1f\n", name, jitter, lag);
+    }
+
+    const float betas[] = { 0.0f, config.position_beta, 0.05f };
+    for (float beta : betas)
+    {
+        SmoothingConfig reach_config = config;
+        reach_config.position_beta = beta;
+        JointSmoother reach_smoother(1, reach_config);
+        std::vector<float> skeleton(g_skeletonChannelCount, 0.0f);
+        std::vector<float> out(g_skeletonChannelCount);
+        std::vector<float> filtered(noisy.size());
+        for (size_t frame = 0; frame < noisy.size(); frame++)
+        {
+            skeleton[0] = noisy[frame];
+            skeleton[3] = 1.0f; // Identity orientation
+            reach_smoother.Apply(0, 1, skeleton.data(), (frame + 1) * frame_usec, out.data());
+            filtered[frame] = out[0];
+        }
+        MeasureLagAndJitter(truth, filtered, frame_s, move_s, hold_s, &jitter, &lag);
+        char name[32];
+        snprintf(name, sizeof(name), "one-euro beta %.3f", beta);
+        printf("  %-22s %9.2f %9.1f\n", name, jitter, lag);
+    }
+    return 0;
+}
+
+// Times the bone length filter on jittered skeletons, then checks that an estimate started on
+// skeletons 35% too short recovers once the correct lengths come in
+static int RunConstrainedBenchmark()
+{
+    const size_t body_count = 6;
+    const int rounds = 100000;
+
+    const size_t cycle = 64;
+    std::vector<k4abt_skeleton_t> skeletons = MakeSyntheticSkeletons(body_count);
+    std::vector<float> joints(cycle * body_count * g_skeletonChannelCount);
+    std::vector<float> constrained(body_count * g_skeletonChannelCount);
+    std::vector<uint8_t> confidence(K4ABT_JOINT_COUNT, (uint8_t)K4ABT_JOINT_CONFIDENCE_MEDIUM);
+    uint32_t seed = 12345;
+    for (size_t frame = 0; frame < cycle; frame++)
+    {
+        for (size_t i = 0; i < body_count; i++)
+        {
+            float* packed = joints.data() + (frame * body_count + i) * g_skeletonChannelCount;
+            PackSkeletonScalar(skeletons[i], packed);
+            for (int channel = 0; channel < g_skeletonChannelCount; channel++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                float jitter = (float)(seed >> 8) / 16777216.0f - 0.5f;
+                packed[channel] += channel % g_channelsPerJoint < 3 ? 10.0f * jitter : 0.02f * jitter;
+            }
+        }
+    }
+    BoneLengthFilter filter((int)body_count);
+    float checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        const float* frame = joints.data() + (round % cycle) * body_count * g_skeletonChannelCount;
+        for (size_t i = 0; i < body_count; i++)
+        {
+            filter.Apply((int)i, (uint32_t)i + 1, frame + i * g_skeletonChannelCount, confidence.data(),
+                constrained.data() + i * g_skeletonChannelCount);
+        }
+        checksum += constrained[round % constrained.size()];
+    }
+    double body_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ((double)rounds * body_count);
+
+    printf("Constrained skeleton benchmark (%zu bodies per frame, %d frames, checksum %g)\n", body_count, rounds, checksum);
+    printf("  %7.1f ns per skeleton, %8.1f ns per frame\n", body_ns, body_ns * body_count);
+
+    // The same body, first scaled to 65% about its chest, then at its true size
+    std::vector<float> full(g_skeletonChannelCount), shrunk(g_skeletonChannelCount), out(g_skeletonChannelCount);
+    PackSkeletonScalar(skeletons[0], full.data());
+    shrunk = full;
+    const float* chest = full.data() + K4ABT_JOINT_SPINE_CHEST * g_channelsPerJoint;
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float& v = shrunk[joint * g_channelsPerJoint + axis];
+            v = chest[axis] + 0.65f * (v - chest[axis]);
+        }
+    }
+    BoneVectors truth, result;
+    ComputeBoneVectors(full.data(), &truth);
+
+    BoneLengthFilter recovery(1);
+    const int biased_frames = 20, max_frames = 4 * BONE_LENGTH_MAX_REJECTIONS;
+    for (int frame = 0; frame < biased_frames; frame++)
+    {
+        recovery.Apply(0, 1, shrunk.data(), confidence.data(), out.data());
+    }
+    int recovered = -1;
+    for (int frame = 1; frame <= max_frames && recovered < 0; frame++)
+    {
+        recovery.Apply(0, 1, full.data(), confidence.data(), out.data());
+        ComputeBoneVectors(out.data(), &result);
+        float worst = 0;
+        for (int bone = 0; bone < BONE_COUNT; bone++)
+        {
+            worst = std::max(worst, fabsf(result.length[bone] - truth.length[bone]) / truth.length[bone]);
+        }
+        if (worst < 0.01f)
+        {
+            recovered = frame;
+        }
+    }
+    if (recovered < 0)
+    {
+        printf("  ERROR: lengths still off %d frames after a %d-frame start at 65%%\n", max_frames, biased_frames);
+        return 1;
+    }
+    printf("  after a %d-frame start at 65%% of the true lengths, recovered within 1%% after %d frames\n", biased_frames, recovered);
+    return 0;
+}
+
+// A frame of the synthetic multi-device sequences: which capture it came from, to check the sets
+struct SyntheticFrame
+{
+    int capture;
+};
+
+struct SyntheticArrival
+{
+    int64_t arrival_usec;
+    int device;
+    int capture;
+    int64_t timestamp_usec;
+};
+
+// Three devices at 30 fps as the assembler sees them: timestamps with a per-device phase and clock
+// jitter, a fraction of captures dropped, tracker latency that varies per frame so devices overtake
+// each other, and optionally one device stalling for a second halfway through
+static std::vector<SyntheticArrival> MakeSyntheticArrivals(int devices, int captures, const int64_t* phase_usec,
+    int64_t jitter_usec, uint32_t drop_per_mille, bool stall)
+{
+    const int64_t frame_usec = 33333;
+    std::vector<SyntheticArrival> arrivals;
+    uint32_t seed = 4242;
+    for (int device = 0; device < devices; device++)
+    {
+        int64_t last_arrival = 0;
+        for (int capture = 0; capture < captures; capture++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            if ((seed >> 8) % 1000 < drop_per_mille || (stall && device == devices - 1 && capture >= captures / 2 && capture < captures / 2 + 30))
+            {
+                continue;
+            }
+            seed = seed * 1664525u + 1013904223u;
+            int64_t timestamp = capture * frame_usec + phase_usec[device] + (int64_t)((seed >> 8) % (2 * jitter_usec + 1)) - jitter_usec;
+            seed = seed * 1664525u + 1013904223u;
+            int64_t latency = 30000 + (int64_t)((seed >> 8) % 40000); // 30-70 ms in the tracker
+            last_arrival = std::max(last_arrival + 1, timestamp + latency);
+            arrivals.push_back({ last_arrival, device, capture, timestamp });
+        }
+    }
+    std::sort(arrivals.begin(), arrivals.end(),
+        [](const SyntheticArrival& a, const SyntheticArrival& b) { return a.arrival_usec < b.arrival_usec; });
+    return arrivals;
+}
+
+static int RunFrameSetBenchmark()
+{
+    const int devices = 3;
+    const int captures = 100000;
+    const int64_t synced_phase[devices] = { 0, 0, 0 };
+    const int64_t free_phase[devices] = { 0, 9000, 14000 };
+
+    struct Scenario
+    {
+        const char* name;
+        const int64_t* phase_usec;
+        int64_t jitter_usec;
+        uint32_t drop_per_mille;
+        bool stall;
+        int64_t tolerance_usec;
+    };
+    const Scenario scenarios[] = {
+        { "wired sync", synced_phase, 50, 0, false, 1000 },
+        { "wired, 1% dropped", synced_phase, 50, 10, false, 1000 },
+        { "wired, stalls", synced_phase, 50, 10, true, 1000 },
+        { "free running", free_phase, 500, 10, false, 16000 },
+    };
+
+    printf("Frame set benchmark (%d devices, %d captures each, tracker latency 30-70 ms)\n", devices, captures);
+    uint64_t total_wrong = 0;
+    printf("  %-18s %9s %9s %7s %8s %8s %7s %10s %8s\n", "sequence", "complete", "partial", "late", "overflow", "orphaned",
+        "wrong", "max spread", "ns/frame");
+    for (const Scenario& scenario : scenarios)
+    {
+        std::vector<SyntheticArrival> arrivals = MakeSyntheticArrivals(devices, captures, scenario.phase_usec,
+            scenario.jitter_usec, scenario.drop_per_mille, scenario.stall);
+        FrameSetConfig config;
+        config.tolerance_usec = scenario.tolerance_usec;
+        FrameSetAssembler<SyntheticFrame> assembler(devices, config);
+
+        // A set is wrong if its frames come from different captures
+        uint64_t wrong = 0;
+        int64_t max_spread = 0;
+        FrameSet<SyntheticFrame> set;
+        auto start = std::chrono::steady_clock::now();
+        for (const SyntheticArrival& arrival : arrivals)
+        {
+            SyntheticFrame* frame = assembler.BeginAdd(arrival.device, arrival.timestamp_usec);
+            if (frame != NULL)
+            {
+                frame->capture = arrival.capture;
+                assembler.CommitAdd(arrival.device);
+            }
+            while (assembler.Front(set))
+            {
+                int capture = -1;
+                for (int device = 0; device < devices; device++)
+                {
+                    if (set.frames[device] != NULL)
+                    {
+                        wrong += capture >= 0 && set.frames[device]->capture != capture;
+                        capture = set.frames[device]->capture;
+                    }
+                }
+                max_spread = std::max(max_spread, set.spread_usec);
+                assembler.Pop(set);
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double frame_ns = std::chrono::duration<double, std::nano>(elapsed).count() / arrivals.size();
+
+        FrameSetStats stats = assembler.GetStats();
+        printf("  %-18s %9llu %9llu %7llu %8llu %8llu %7llu %7lld us %8.1f\n", scenario.name, (unsigned long long)stats.complete,
+            (unsigned long long)stats.partial, (unsigned long long)stats.dropped_late, (unsigned long long)stats.dropped_overflow,
+            (unsigned long long)stats.dropped_orphan, (unsigned long long)wrong, (long long)max_spread, frame_ns);
+        total_wrong += wrong;
+    }
+
+    if (total_wrong > 0)
+    {
+        printf("Frame set benchmark: %llu sets mix frames of different captures!\n", (unsigned long long)total_wrong);
+        return 1;
+    }
+    return 0;
+}
+
+// Mean distance of the present joints from the truth, and how many joints are present
+static void MeasureJointError(const float* joints, const float* truth, double* error_sum, uint64_t* present)
+{
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        const float* p = joints + joint * g_channelsPerJoint;
+        const float* t = truth + joint * g_channelsPerJoint;
+        if (p[0] == p[0])
+        {
+            *error_sum += sqrt((p[0] - t[0]) * (p[0] - t[0]) + (p[1] - t[1]) * (p[1] - t[1]) + (p[2] - t[2]) * (p[2] - t[2]));
+            (*present)++;
+        }
+    }
+}
+
+static int RunFuseBenchmark()
+{
+    const int devices = 3;
+    const int bodies = 2;
+    const size_t cycle = 64;
+    const int rounds = 100000;
+    const float pi = 3.14159265f;
+
+    // Three cameras on a 2.5 m circle around the subjects, every one looking at the centre; camera 0's
+    // frame is the world frame (x right, y down, z away from camera 0)
+    const float centre[3] = { 0.0f, 0.0f, 2500.0f };
+    std::vector<Extrinsics> extrinsics(devices);
+    for (int device = 0; device < devices; device++)
+    {
+        const float angle = 2.0f * pi * device / devices;
+        float* r = extrinsics[device].rotation;
+        r[0] = cosf(angle); r[1] = 0.0f; r[2] = sinf(angle);
+        r[3] = 0.0f;        r[4] = 1.0f; r[5] = 0.0f;
+        r[6] = -sinf(angle); r[7] = 0.0f; r[8] = cosf(angle);
+        extrinsics[device].translation[0] = centre[0] - r[2] * centre[2];
+        extrinsics[device].translation[1] = centre[1];
+        extrinsics[device].translation[2] = centre[2] - r[8] * centre[2];
+    }
+
+    // Bodies turning on the spot, so every camera sees fronts, sides and backs. A joint is occluded
+    // (LOW, 60 mm off) for one frame in ten seen from the front and one in two seen from behind.
+    std::vector<DeviceFrame> frames(cycle * devices);
+    std::vector<float> truth(cycle * bodies * g_skeletonChannelCount);
+    uint32_t seed = 777;
+    auto noise = [&seed](float amplitude)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return amplitude * ((float)(seed >> 8) / 16777216.0f - 0.5f) * 2.0f;
+    };
+    for (size_t frame = 0; frame < cycle; frame++)
+    {
+        for (int body = 0; body < bodies; body++)
+        {
+            const float yaw = 2.0f * pi * frame / cycle + pi * body;
+            float* t = truth.data() + (frame * bodies + body) * g_skeletonChannelCount;
+            for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+            {
+                // A body outline facing -z before it turns: left is +x, up is -y
+                float local[3] = { 0.0f, -15.0f * joint, 30.0f * (joint % 3) };
+                if (joint == K4ABT_JOINT_SHOULDER_LEFT || joint == K4ABT_JOINT_SHOULDER_RIGHT)
+                {
+                    local[0] = joint == K4ABT_JOINT_SHOULDER_LEFT ? 200.0f : -200.0f;
+                    local[1] = -450.0f;
+                    local[2] = 0.0f;
+                }
+                else if (joint == K4ABT_JOINT_NECK)
+                {
+                    local[1] = -550.0f;
+                    local[2] = 0.0f;
+                }
+                else if (joint == K4ABT_JOINT_PELVIS)
+                {
+                    local[1] = 0.0f;
+                    local[2] = 0.0f;
+                }
+                float* p = t + joint * g_channelsPerJoint;
+                p[0] = centre[0] + (body == 0 ? -600.0f : 600.0f) + cosf(yaw) * local[0] + sinf(yaw) * local[2];
+                p[1] = centre[1] + local[1];
+                p[2] = centre[2] - sinf(yaw) * local[0] + cosf(yaw) * local[2];
+                p[3] = 1.0f; p[4] = 0.0f; p[5] = 0.0f; p[6] = 0.0f;
+            }
+        }
+        for (int device = 0; device < devices; device++)
+        {
+            DeviceFrame& view = frames[frame * devices + device];
+            const Extrinsics& e = extrinsics[device];
+            view.timestamp = 0;
+            view.device_usec = 0;
+            view.body_slots = bodies;
+            for (int body = 0; body < bodies; body++)
+            {
+                view.body_ids[body] = body + 1;
+                const float yaw = 2.0f * pi * frame / cycle + pi * body;
+                const float camera_angle = 2.0f * pi * device / devices;
+                const bool from_behind = cosf(yaw - camera_angle) < 0.0f;
+                const float* t = truth.data() + (frame * bodies + body) * g_skeletonChannelCount;
+                float* joints = view.joints + body * g_skeletonChannelCount;
+                for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+                {
+                    const bool occluded = noise(0.5f) + 0.5f < (from_behind ? 0.5f : 0.1f);
+                    const float error = occluded ? 60.0f : 10.0f;
+                    const float* w = t + joint * g_channelsPerJoint;
+                    const float d[3] = { w[0] - e.translation[0] + noise(error), w[1] - e.translation[1] + noise(error),
+                        w[2] - e.translation[2] + noise(error) };
+                    float* p = joints + joint * g_channelsPerJoint;
+                    // Camera = R^T (world - translation); the world orientation is the identity
+                    p[0] = e.rotation[0] * d[0] + e.rotation[3] * d[1] + e.rotation[6] * d[2];
+                    p[1] = e.rotation[1] * d[0] + e.rotation[4] * d[1] + e.rotation[7] * d[2];
+                    p[2] = e.rotation[2] * d[0] + e.rotation[5] * d[1] + e.rotation[8] * d[2];
+                    p[3] = cosf(camera_angle / 2); p[4] = 0.0f; p[5] = -sinf(camera_angle / 2); p[6] = 0.0f;
+                    view.confidence[body * K4ABT_JOINT_COUNT + joint] = occluded ? K4ABT_JOINT_CONFIDENCE_LOW : K4ABT_JOINT_CONFIDENCE_MEDIUM;
+                }
+            }
+        }
+    }
+
+    SkeletonFusion fusion(extrinsics, bodies);
+    std::vector<float> fused(bodies * g_skeletonChannelCount);
+    uint32_t body_ids[MAX_BODY_SLOTS];
+    const DeviceFrame* set[devices];
+    double fused_error = 0, single_error = 0;
+    uint64_t fused_present = 0, single_present = 0;
+    for (size_t frame = 0; frame < cycle; frame++)
+    {
+        for (int device = 0; device < devices; device++)
+        {
+            set[device] = &frames[frame * devices + device];
+        }
+        fusion.Fuse(set, devices, fused.data(), body_ids);
+        for (int slot = 0; slot < bodies; slot++)
+        {
+            // Slots are handed out in order of the first frame, which starts with body 1 of camera 0
+            const float* t = truth.data() + (frame * bodies + slot) * g_skeletonChannelCount;
+            MeasureJointError(fused.data() + slot * g_skeletonChannelCount, t, &fused_error, &fused_present);
+            MeasureJointError(set[0]->joints + slot * g_skeletonChannelCount, t, &single_error, &single_present);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    float checksum = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int device = 0; device < devices; device++)
+        {
+            set[device] = &frames[(round % cycle) * devices + device];
+        }
+        fusion.Fuse(set, devices, fused.data(), body_ids);
+        checksum += fused[0];
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double set_us = std::chrono::duration<double, std::micro>(elapsed).count() / rounds;
+
+    printf("Fusion benchmark (%d cameras 120 degrees apart, %d turning bodies, %d sets)\n", devices, bodies, rounds);
+    printf("  %.2f us per frame set (checksum %g)\n", set_us, checksum);
+    printf("  mean joint error: camera 0 alone %.1f mm, fused %.1f mm\n", single_error / single_present, fused_error / fused_present);
+    return 0;
+}
+
+int RunBenchmark(const char* name)
+{
+    if (strcmp(name, "pack") == 0)
+    {
+        return RunPackBenchmark();
+    }
+    if (strcmp(name, "select") == 0)
+    {
+        return RunSelectBenchmark();
+    }
+    if (strcmp(name, "rle") == 0)
+    {
+        return RunRleBenchmark();
+    }
+    if (strcmp(name, "cloud") == 0)
+    {
+        return RunCloudBenchmark();
+    }
+    if (strcmp(name, "smooth") == 0)
+    {
+        return RunSmoothBenchmark();
+    }
+    if (strcmp(name, "constrained") == 0)
+    {
+        return RunConstrainedBenchmark();
+    }
+    if (strcmp(name, "frameset") == 0)
+    {
+        return RunFrameSetBenchmark();
+    }
+    if (strcmp(name, "fuse") == 0)
+    {
+        return RunFuseBenchmark();
+    }
+
+    printf("Unknown benchmark: %s\n", name);
+    return 1;
+}
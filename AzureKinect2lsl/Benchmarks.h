@@ -0,0 +1,5 @@
+#pragma once
+
+// Microbenchmarks selected with --benchmark <name>. They run on synthetic data and need no device.
+// Returns the process exit code.
+int RunBenchmark(const char* name);
@@ -0,0 +1,166 @@
+#include "BodyIndexStream.h"
+
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RUN_KERNEL_AVX2
+#define RUN_KERNEL_SIMD
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RUN_KERNEL_SSE2
+#define RUN_KERNEL_SIMD
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static inline int CountTrailingZeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static inline uint8_t* WriteRun(uint8_t* out, uint8_t value, int length)
+{
+    while (length > 255)
+    {
+        *out++ = value;
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = value;
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+static uint8_t* WriteHeader(uint8_t* out, int width, int height)
+{
+    out[0] = (uint8_t)(width & 0xFF);
+    out[1] = (uint8_t)(width >> 8);
+    out[2] = (uint8_t)(height & 0xFF);
+    out[3] = (uint8_t)(height >> 8);
+    return out + BODY_INDEX_HEADER_SIZE;
+}
+
+// Encodes the runs from row[start] on, with row[start] opening the current run
+static uint8_t* EncodeRowTail(const uint8_t* row, int start, int begin, int width, uint8_t* out)
+{
+    for (int i = begin; i < width; i++)
+    {
+        if (row[i] != row[i - 1])
+        {
+            out = WriteRun(out, row[start], i - start);
+            start = i;
+        }
+    }
+    return WriteRun(out, row[start], width - start);
+}
+
+size_t EncodeBodyIndexMapScalar(const uint8_t* map, int width, int height, int stride, uint8_t* out)
+{
+    uint8_t* begin = out;
+    out = WriteHeader(out, width, height);
+    for (int y = 0; y < height && width > 0; y++)
+    {
+        out = EncodeRowTail(map + (size_t)y * stride, 0, 1, width, out);
+    }
+    return out - begin;
+}
+
+// Compares each block of pixels with the same block shifted by one; the set bits of the
+// inverted equality mask are exactly the run starts, and blocks without any are skipped whole.
+size_t EncodeBodyIndexMap(const uint8_t* map, int width, int height, int stride, uint8_t* out)
+{
+#if defined(RUN_KERNEL_SIMD)
+#if defined(RUN_KERNEL_AVX2)
+    const int block = 32;
+#else
+    const int block = 16;
+#endif
+    uint8_t* begin = out;
+    out = WriteHeader(out, width, height);
+    for (int y = 0; y < height && width > 0; y++)
+    {
+        const uint8_t* row = map + (size_t)y * stride;
+        int start = 0;
+        int i = 1;
+        for (; i + block <= width; i += block)
+        {
+#if defined(RUN_KERNEL_AVX2)
+            __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+            __m256i previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i - 1));
+            uint32_t changes = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(current, previous));
+#else
+            __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - 1));
+            uint32_t changes = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(current, previous)) & 0xFFFF;
+#endif
+            while (changes != 0)
+            {
+                int position = i + CountTrailingZeros(changes);
+                out = WriteRun(out, row[start], position - start);
+                start = position;
+                changes &= changes - 1;
+            }
+        }
+        out = EncodeRowTail(row, start, i, width, out);
+    }
+    return out - begin;
+#else
+    return EncodeBodyIndexMapScalar(map, width, height, stride, out);
+#endif
+}
+
+void RemapBodyIndexMap(const uint8_t* map, int width, int height, int stride, const uint8_t* table, uint8_t* out)
+{
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* row = map + (size_t)y * stride;
+        for (int x = 0; x < width; x++)
+        {
+            *out++ = table[row[x]];
+        }
+    }
+}
+
+size_t GetBodyIndexEncodedCapacity(int width, int height)
+{
+    return BODY_INDEX_HEADER_SIZE + (size_t)width * height * 2;
+}
+
+const char* GetRunFinderKernelName()
+{
+#if defined(RUN_KERNEL_AVX2)
+    return "avx2";
+#elif defined(RUN_KERNEL_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+lsl_streaminfo CreateBodyIndexStreamInfo(const std::string& source_id, double nominal_srate, int width, int height)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-BodyIndex", "Segmentation", 1, nominal_srate, cft_string,
+        (source_id + "-bodyindex").c_str());
+
+    lsl_xml_ptr desc = lsl_get_desc(info);
+    lsl_append_child_value(desc, "manufacturer", "University of Groningen");
+    lsl_append_child_value(desc, "model", "Azure Kinect");
+    lsl_xml_ptr encoding = lsl_append_child(desc, "encoding");
+    lsl_append_child_value(encoding, "format", "row-rle");
+    lsl_append_child_value(encoding, "header", "width uint16le, height uint16le");
+    lsl_append_child_value(encoding, "rows", "(value, length) byte pairs per row, runs of at most 255");
+    lsl_append_child_value(encoding, "background", "255");
+    lsl_append_child_value(encoding, "values", "skeleton slot of the body, bodies without a slot are background");
+    lsl_append_child_value(encoding, "width", std::to_string(width).c_str());
+    lsl_append_child_value(encoding, "height", std::to_string(height).c_str());
+    return info;
+}
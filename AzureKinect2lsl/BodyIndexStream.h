@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <lsl_cpp.h>
+
+// Encoded body index maps start with the map width and height, each a little-endian uint16
+#define BODY_INDEX_HEADER_SIZE 4
+
+/**
+ * Row-wise run-length encoding of a body index map (K4ABT_BODY_INDEX_MAP_BACKGROUND or a body
+ * number, one byte per depth pixel). After the header every row is a
+ * sequence of (value, length) byte pairs whose lengths add up to the width; runs longer than
+ * 255 are split and no run crosses a row boundary, so a decoder can start at any row.
+ * Returns the encoded size, at most GetBodyIndexEncodedCapacity(width, height).
+ * Runs are located with the widest SIMD compare the build targets.
+ */
+size_t EncodeBodyIndexMap(const uint8_t* map, int width, int height, int stride, uint8_t* out);
+
+// Byte-by-byte run finder. Used as the benchmark baseline; produces identical output.
+size_t EncodeBodyIndexMapScalar(const uint8_t* map, int width, int height, int stride, uint8_t* out);
+
+// Rewrites every pixel through a 256-entry table into a packed width x height map, e.g. from the
+// tracker's frame-local body index to the body's skeleton slot.
+void RemapBodyIndexMap(const uint8_t* map, int width, int height, int stride, const uint8_t* table, uint8_t* out);
+
+// Worst case encoded size: every pixel its own run
+size_t GetBodyIndexEncodedCapacity(int width, int height);
+
+// Name of the kernel EncodeBodyIndexMap uses ("avx2", "sse2" or "scalar").
+const char* GetRunFinderKernelName();
+
+// Stream info for the encoded maps: one string channel carrying the bytes of one map per sample.
+lsl_streaminfo CreateBodyIndexStreamInfo(const std::string& source_id, double nominal_srate, int width, int height);
@@ -0,0 +1,30 @@
+#include "BodyOutletPool.h"
+
+#include <algorithm>
+#include <k4abttypes.h>
+
+BodyOutletPool::BodyOutletPool(const std::string& source_id, int body_slots, double nominal_srate, const StreamConfig& config)
+    : m_slotCount(std::min(std::max(body_slots, 0), MAX_BODY_SLOTS))
+{
+    for (int slot = 0; slot < m_slotCount; slot++)
+    {
+        m_outlets[slot] = CreateSkeletonOutlet(CreateBodyStreamInfo(source_id, nominal_srate, slot, config), config);
+        m_bodyIds[slot] = K4ABT_INVALID_BODY_ID;
+    }
+}
+
+BodyOutletPool::~BodyOutletPool()
+{
+    for (int slot = 0; slot < m_slotCount; slot++)
+    {
+        lsl_destroy_outlet(m_outlets[slot]);
+    }
+}
+
+bool BodyOutletPool::Push(int slot, uint32_t body_id, const float* joints, double timestamp)
+{
+    lsl_push_sample_ft(m_outlets[slot], joints, timestamp);
+    bool recycled = m_bodyIds[slot] != body_id;
+    m_bodyIds[slot] = body_id;
+    return recycled;
+}
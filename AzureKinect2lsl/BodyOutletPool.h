@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <lsl_cpp.h>
+#include "BodySlots.h"
+#include "SkeletonStream.h"
+
+/**
+ * One LSL outlet per body slot, for consumers that want a stream per person.
+ * Building a 224-channel stream info and creating an outlet takes long enough to hold up the
+ * publisher, so every outlet is created up front and a slot's outlet is reused by whichever body
+ * takes the slot next. The source_id is "<device source_id>-body<slot>", so a recorder that lost a
+ * stream picks it up again when a body returns to that slot or the streamer is restarted.
+ */
+class BodyOutletPool
+{
+public:
+    // Creates body_slots outlets; 0 creates none and leaves the pool disabled
+    BodyOutletPool(const std::string& source_id, int body_slots, double nominal_srate, const StreamConfig& config);
+    ~BodyOutletPool();
+
+    int GetSlotCount() const { return m_slotCount; }
+
+    // Pushes the skeleton of the body in the slot. Returns true when a different body than
+    // last time is publishing on the slot's outlet.
+    bool Push(int slot, uint32_t body_id, const float* joints, double timestamp);
+
+private:
+    int m_slotCount;
+    lsl_outlet m_outlets[MAX_BODY_SLOTS];
+    uint32_t m_bodyIds[MAX_BODY_SLOTS]; // Body last published on each outlet
+};
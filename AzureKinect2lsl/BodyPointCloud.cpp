@@ -0,0 +1,184 @@
+#include "BodyPointCloud.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <k4abttypes.h>
+
+// Voxel coordinates are stored as 20-bit fields, offset so negative coordinates stay positive
+#define VOXEL_COORDINATE_BITS 20
+#define VOXEL_COORDINATE_OFFSET (1 << (VOXEL_COORDINATE_BITS - 1))
+
+// The ray through every depth pixel at 1 mm, the same table the SDK's fastpointcloud sample uses
+static std::vector<k4a_float2_t> BuildXyTable(const k4a_calibration_t& calibration)
+{
+    const int width = calibration.depth_camera_calibration.resolution_width;
+    const int height = calibration.depth_camera_calibration.resolution_height;
+    std::vector<k4a_float2_t> xy_table((size_t)width * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            k4a_float2_t point;
+            point.xy.x = (float)x;
+            point.xy.y = (float)y;
+            k4a_float3_t ray;
+            int valid = 0;
+            k4a_calibration_2d_to_3d(&calibration, &point, 1.0f, K4A_CALIBRATION_TYPE_DEPTH, K4A_CALIBRATION_TYPE_DEPTH, &ray, &valid);
+
+            k4a_float2_t& entry = xy_table[(size_t)y * width + x];
+            entry.xy.x = valid ? ray.xyz.x : std::numeric_limits<float>::quiet_NaN();
+            entry.xy.y = valid ? ray.xyz.y : std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+    return xy_table;
+}
+
+BodyPointCloud::BodyPointCloud(const k4a_calibration_t& calibration, float voxel_mm)
+    : BodyPointCloud(calibration.depth_camera_calibration.resolution_width, calibration.depth_camera_calibration.resolution_height,
+        BuildXyTable(calibration), voxel_mm)
+{
+}
+
+BodyPointCloud::BodyPointCloud(int width, int height, const std::vector<k4a_float2_t>& xy_table, float voxel_mm)
+    : m_width(width), m_height(height), m_inverseVoxel(1.0f / voxel_mm), m_xyTable(xy_table)
+{
+    // Twice as many entries as voxels keeps the probe sequences short
+    size_t table_size = 1;
+    m_hashShift = 64;
+    while (table_size < 2 * MAX_CLOUD_VOXELS)
+    {
+        table_size <<= 1;
+        m_hashShift--;
+    }
+    m_mask = table_size - 1;
+    m_voxels.resize(table_size);
+    m_used.reserve(MAX_CLOUD_VOXELS);
+}
+
+void BodyPointCloud::Accumulate(uint64_t key, float x, float y, float z)
+{
+    uint64_t index = (key * 0x9E3779B97F4A7C15ull) >> m_hashShift;
+    while (true)
+    {
+        Voxel& voxel = m_voxels[index];
+        if (voxel.generation != m_generation)
+        {
+            if (m_used.size() == MAX_CLOUD_VOXELS)
+            {
+                m_droppedVoxels++;
+                return;
+            }
+            voxel.key = key;
+            voxel.sum[0] = x;
+            voxel.sum[1] = y;
+            voxel.sum[2] = z;
+            voxel.count = 1;
+            voxel.generation = m_generation;
+            m_used.push_back((uint32_t)index);
+            return;
+        }
+        if (voxel.key == key)
+        {
+            voxel.sum[0] += x;
+            voxel.sum[1] += y;
+            voxel.sum[2] += z;
+            voxel.count++;
+            return;
+        }
+        index = (index + 1) & m_mask;
+    }
+}
+
+size_t BodyPointCloud::Extract(const uint16_t* depth, int depth_stride, const uint8_t* body_index, int index_stride,
+    const uint32_t* body_ids, size_t num_bodies, float* out)
+{
+    // A new generation invalidates every entry of the last frame at once. Entries start at
+    // generation 0, so skip it when the counter wraps.
+    if (++m_generation == 0)
+    {
+        for (Voxel& voxel : m_voxels)
+        {
+            voxel.generation = 0;
+        }
+        m_generation = 1;
+    }
+    m_used.clear();
+
+    const uint64_t background8 = 0x0101010101010101ull * K4ABT_BODY_INDEX_MAP_BACKGROUND;
+    for (int y = 0; y < m_height; y++)
+    {
+        const uint8_t* index_row = body_index + (size_t)y * index_stride;
+        const uint16_t* depth_row = reinterpret_cast<const uint16_t*>(reinterpret_cast<const uint8_t*>(depth) + (size_t)y * depth_stride);
+        const k4a_float2_t* xy_row = m_xyTable.data() + (size_t)y * m_width;
+
+        int x = 0;
+        while (x < m_width)
+        {
+            // Most of the map is background; skip it eight pixels at a time
+            if (x + 8 <= m_width)
+            {
+                uint64_t pixels;
+                memcpy(&pixels, index_row + x, sizeof(pixels));
+                if (pixels == background8)
+                {
+                    x += 8;
+                    continue;
+                }
+            }
+
+            const uint8_t body = index_row[x];
+            const uint16_t d = depth_row[x];
+            const k4a_float2_t& ray = xy_row[x];
+            if (body != K4ABT_BODY_INDEX_MAP_BACKGROUND && body < num_bodies && d != 0 && !isnan(ray.xy.x))
+            {
+                float px = ray.xy.x * d;
+                float py = ray.xy.y * d;
+                float pz = (float)d;
+                uint64_t vx = (uint64_t)((int64_t)floorf(px * m_inverseVoxel) + VOXEL_COORDINATE_OFFSET) & ((1 << VOXEL_COORDINATE_BITS) - 1);
+                uint64_t vy = (uint64_t)((int64_t)floorf(py * m_inverseVoxel) + VOXEL_COORDINATE_OFFSET) & ((1 << VOXEL_COORDINATE_BITS) - 1);
+                uint64_t vz = (uint64_t)((int64_t)floorf(pz * m_inverseVoxel) + VOXEL_COORDINATE_OFFSET) & ((1 << VOXEL_COORDINATE_BITS) - 1);
+                uint64_t key = ((uint64_t)body << (3 * VOXEL_COORDINATE_BITS)) | (vz << (2 * VOXEL_COORDINATE_BITS)) | (vy << VOXEL_COORDINATE_BITS) | vx;
+                Accumulate(key, px, py, pz);
+            }
+            x++;
+        }
+    }
+
+    // One centroid per voxel, in the order the voxels were first hit; consumers split on the body id
+    for (size_t i = 0; i < m_used.size(); i++)
+    {
+        const Voxel& voxel = m_voxels[m_used[i]];
+        const float inverse_count = 1.0f / voxel.count;
+        float* point = out + i * POINT_CLOUD_CHANNEL_COUNT;
+        point[0] = voxel.sum[0] * inverse_count;
+        point[1] = voxel.sum[1] * inverse_count;
+        point[2] = voxel.sum[2] * inverse_count;
+        point[3] = (float)body_ids[voxel.key >> (3 * VOXEL_COORDINATE_BITS)];
+    }
+    return m_used.size();
+}
+
+lsl_streaminfo CreatePointCloudStreamInfo(const std::string& source_id, float voxel_mm)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-PointCloud", "PointCloud", POINT_CLOUD_CHANNEL_COUNT,
+        LSL_IRREGULAR_RATE, cft_float32, (source_id + "-pointcloud").c_str());
+
+    lsl_xml_ptr desc = lsl_get_desc(info);
+    lsl_append_child_value(desc, "manufacturer", "University of Groningen");
+    lsl_append_child_value(desc, "model", "Azure Kinect");
+    lsl_append_child_value(desc, "voxel_size_mm", std::to_string(voxel_mm).c_str());
+
+    const char* channel_names[POINT_CLOUD_CHANNEL_COUNT] = { "x", "y", "z", "body_id" };
+    const char* channel_units[POINT_CLOUD_CHANNEL_COUNT] = { "mm", "mm", "mm", "id" };
+    lsl_xml_ptr chns = lsl_append_child(desc, "channels");
+    for (int channel = 0; channel < POINT_CLOUD_CHANNEL_COUNT; channel++)
+    {
+        lsl_xml_ptr node = lsl_append_child(chns, "channel");
+        lsl_append_child_value(node, "name", channel_names[channel]);
+        lsl_append_child_value(node, "unit", channel_units[channel]);
+    }
+    return info;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <lsl_cpp.h>
+#include <k4a/k4a.h>
+
+// Values per point on the point cloud stream: x, y, z in mm and the body id
+#define POINT_CLOUD_CHANNEL_COUNT 4
+
+// Most voxels kept per frame, over all bodies; further voxels are dropped and counted
+#define MAX_CLOUD_VOXELS 16384
+
+/**
+ * Turns the body pixels of a depth image into per-body point clouds, downsampled to one point
+ * (the centroid) per occupied voxel.
+ * Unprojection uses an xy table computed once from the calibration: for every depth pixel the
+ * ray through it at 1 mm depth, so a pixel becomes (x * depth, y * depth, depth) instead of a
+ * k4a_calibration_2d_to_3d call. Voxels are accumulated in a fixed-size hash table that is
+ * invalidated per frame by a generation counter, so nothing is cleared or allocated per frame.
+ */
+class BodyPointCloud
+{
+public:
+    BodyPointCloud(const k4a_calibration_t& calibration, float voxel_mm);
+
+    // Uses a ready-made xy table of width * height rays, e.g. a pinhole model for synthetic data
+    BodyPointCloud(int width, int height, const std::vector<k4a_float2_t>& xy_table, float voxel_mm);
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    // Extracts the clouds of one frame. depth and body_index are the depth image and the body index
+    // map of the same frame, both GetWidth() x GetHeight(); body_ids[i] is the id of body index i.
+    // Writes POINT_CLOUD_CHANNEL_COUNT floats per point to out, which must hold MAX_CLOUD_VOXELS
+    // points, and returns the number of points.
+    size_t Extract(const uint16_t* depth, int depth_stride, const uint8_t* body_index, int index_stride,
+        const uint32_t* body_ids, size_t num_bodies, float* out);
+
+    // Voxels dropped since construction because the table was full
+    uint64_t GetDroppedVoxels() const { return m_droppedVoxels; }
+
+private:
+    struct Voxel
+    {
+        uint64_t key;
+        float sum[3];
+        uint32_t count;
+        uint32_t generation;
+    };
+
+    void Accumulate(uint64_t key, float x, float y, float z);
+
+    int m_width;
+    int m_height;
+    float m_inverseVoxel;
+    std::vector<k4a_float2_t> m_xyTable; // NaN where the pixel does not unproject
+    std::vector<Voxel> m_voxels;         // Open addressing, power-of-two size
+    std::vector<uint32_t> m_used;        // Table entries filled this frame, in insertion order
+    uint64_t m_mask;
+    int m_hashShift;
+    uint32_t m_generation = 0;
+    uint64_t m_droppedVoxels = 0;
+};
+
+// Stream info for the point clouds: POINT_CLOUD_CHANNEL_COUNT float channels, irregular rate so
+// every point pushed in one chunk carries the frame's timestamp.
+lsl_streaminfo CreatePointCloudStreamInfo(const std::string& source_id, float voxel_mm);
@@ -0,0 +1,56 @@
+#include "BodySlots.h"
+
+#include <algorithm>
+#include <k4abttypes.h>
+
+BodySlotMap::BodySlotMap(int slot_count)
+    : m_slotCount(std::min(std::max(slot_count, 1), MAX_BODY_SLOTS))
+{
+    std::fill(m_slotIds, m_slotIds + MAX_BODY_SLOTS, K4ABT_INVALID_BODY_ID);
+}
+
+int BodySlotMap::FindSlot(uint32_t body_id) const
+{
+    for (int slot = 0; slot < m_slotCount; slot++)
+    {
+        if (m_slotIds[slot] == body_id)
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+size_t BodySlotMap::Assign(const uint32_t* body_ids, size_t num_bodies, int* slot_of_body)
+{
+    // Free the slots of bodies that are no longer tracked
+    for (int slot = 0; slot < m_slotCount; slot++)
+    {
+        if (m_slotIds[slot] != K4ABT_INVALID_BODY_ID &&
+            std::find(body_ids, body_ids + num_bodies, m_slotIds[slot]) == body_ids + num_bodies)
+        {
+            m_slotIds[slot] = K4ABT_INVALID_BODY_ID;
+        }
+    }
+
+    // Known bodies stay where they are, new ones take the lowest free slot
+    size_t unassigned = 0;
+    for (size_t i = 0; i < num_bodies; i++)
+    {
+        int slot = FindSlot(body_ids[i]);
+        if (slot < 0)
+        {
+            slot = FindSlot(K4ABT_INVALID_BODY_ID);
+            if (slot >= 0)
+            {
+                m_slotIds[slot] = body_ids[i];
+            }
+            else
+            {
+                unassigned++;
+            }
+        }
+        slot_of_body[i] = slot;
+    }
+    return unassigned;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Most bodies one sample can carry
+#define MAX_BODY_SLOTS 6
+
+// Most bodies looked at in one body frame; any beyond this are ignored like bodies without a slot
+#define MAX_FRAME_BODIES 32
+
+/**
+ * Assigns tracked bodies to a fixed number of stream slots.
+ * A body keeps its slot for as long as the tracker reports its id, and the slot is freed in the
+ * first frame the id is missing. New bodies take the lowest free slot; when every slot is taken
+ * they are left out until one frees up. All state is a fixed-size array, so bodies coming and
+ * going never allocate.
+ */
+class BodySlotMap
+{
+public:
+    explicit BodySlotMap(int slot_count);
+
+    // Maps the bodies of one frame onto slots. slot_of_body[i] receives the slot of body_ids[i],
+    // or -1 if every slot is held by another body. Returns the number of bodies left without a slot.
+    size_t Assign(const uint32_t* body_ids, size_t num_bodies, int* slot_of_body);
+
+    int GetSlotCount() const { return m_slotCount; }
+
+    // Id of the body in the slot, K4ABT_INVALID_BODY_ID if the slot is empty
+    uint32_t GetBodyId(int slot) const { return m_slotIds[slot]; }
+
+private:
+    int FindSlot(uint32_t body_id) const;
+
+    int m_slotCount;
+    uint32_t m_slotIds[MAX_BODY_SLOTS];
+};
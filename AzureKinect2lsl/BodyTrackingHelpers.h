@@ -3,11 +3,10 @@
 // Licensed under the MIT License.
 
 #include <array>
-#include <unordered_map>
 #include <k4abttypes.h>
 
 // Define the bone list based on the documentation
-const std::array<std::pair<k4abt_joint_id_t, k4abt_joint_id_t>, 31> g_boneList =
+constexpr std::array<std::pair<k4abt_joint_id_t, k4abt_joint_id_t>, 31> g_boneList =
 {
     std::make_pair(K4ABT_JOINT_SPINE_CHEST, K4ABT_JOINT_SPINE_NAVEL),
     std::make_pair(K4ABT_JOINT_SPINE_NAVEL, K4ABT_JOINT_PELVIS),
@@ -44,43 +43,53 @@ const std::array<std::pair<k4abt_joint_id_t, k4abt_joint_id_t>, 31> g_boneList =
     std::make_pair(K4ABT_JOINT_EYE_RIGHT, K4ABT_JOINT_EAR_RIGHT)
 };
 
-// Define the joint string names
-const std::unordered_map<k4abt_joint_id_t, std::string> g_jointNames =
+// Define the joint string names, indexed by k4abt_joint_id_t
+constexpr std::array<const char*, K4ABT_JOINT_COUNT> g_jointNames =
 {
-    std::make_pair(K4ABT_JOINT_PELVIS,        "PELVIS"),
-    std::make_pair(K4ABT_JOINT_SPINE_NAVEL,   "SPINE_NAVEL"),
-    std::make_pair(K4ABT_JOINT_SPINE_CHEST,   "SPINE_CHEST"),
-    std::make_pair(K4ABT_JOINT_NECK,          "NECK"),
-    std::make_pair(K4ABT_JOINT_CLAVICLE_LEFT, "CLAVICLE_LEFT"),
-    std::make_pair(K4ABT_JOINT_SHOULDER_LEFT, "SHOULDER_LEFT"),
-    std::make_pair(K4ABT_JOINT_ELBOW_LEFT,    "ELBOW_LEFT"),
-    std::make_pair(K4ABT_JOINT_WRIST_LEFT,    "WRIST_LEFT"),
-    std::make_pair(K4ABT_JOINT_HAND_LEFT,     "HAND_LEFT"),
-    std::make_pair(K4ABT_JOINT_HANDTIP_LEFT,  "HANDTIP_LEFT"),
-    std::make_pair(K4ABT_JOINT_THUMB_LEFT,    "THUMB_LEFT"),
-    std::make_pair(K4ABT_JOINT_CLAVICLE_RIGHT,"CLAVICLE_RIGHT"),
-    std::make_pair(K4ABT_JOINT_SHOULDER_RIGHT,"SHOULDER_RIGHT"),
-    std::make_pair(K4ABT_JOINT_ELBOW_RIGHT,   "ELBOW_RIGHT"),
-    std::make_pair(K4ABT_JOINT_WRIST_RIGHT,   "WRIST_RIGHT"),
-    std::make_pair(K4ABT_JOINT_HAND_RIGHT,    "HAND_RIGHT"),
-    std::make_pair(K4ABT_JOINT_HANDTIP_RIGHT, "HANDTIP_RIGHT"),
-    std::make_pair(K4ABT_JOINT_THUMB_RIGHT,   "THUMB_RIGHT"),
-    std::make_pair(K4ABT_JOINT_HIP_LEFT,      "HIP_LEFT"),
-    std::make_pair(K4ABT_JOINT_KNEE_LEFT,     "KNEE_LEFT"),
-    std::make_pair(K4ABT_JOINT_ANKLE_LEFT,    "ANKLE_LEFT"),
-    std::make_pair(K4ABT_JOINT_FOOT_LEFT,     "FOOT_LEFT"),
-    std::make_pair(K4ABT_JOINT_HIP_RIGHT,     "HIP_RIGHT"),
-    std::make_pair(K4ABT_JOINT_KNEE_RIGHT,    "KNEE_RIGHT"),
-    std::make_pair(K4ABT_JOINT_ANKLE_RIGHT,   "ANKLE_RIGHT"),
-    std::make_pair(K4ABT_JOINT_FOOT_RIGHT,    "FOOT_RIGHT"),
-    std::make_pair(K4ABT_JOINT_HEAD,          "HEAD"),
-    std::make_pair(K4ABT_JOINT_NOSE,          "NOSE"),
-    std::make_pair(K4ABT_JOINT_EYE_LEFT,      "EYE_LEFT"),
-    std::make_pair(K4ABT_JOINT_EAR_LEFT,      "EAR_LEFT"),
-    std::make_pair(K4ABT_JOINT_EYE_RIGHT,     "EYE_RIGHT"),
-    std::make_pair(K4ABT_JOINT_EAR_RIGHT,     "EAR_RIGHT")
+    "PELVIS",         // K4ABT_JOINT_PELVIS
+    "SPINE_NAVEL",    // K4ABT_JOINT_SPINE_NAVEL
+    "SPINE_CHEST",    // K4ABT_JOINT_SPINE_CHEST
+    "NECK",           // K4ABT_JOINT_NECK
+    "CLAVICLE_LEFT",  // K4ABT_JOINT_CLAVICLE_LEFT
+    "SHOULDER_LEFT",  // K4ABT_JOINT_SHOULDER_LEFT
+    "ELBOW_LEFT",     // K4ABT_JOINT_ELBOW_LEFT
+    "WRIST_LEFT",     // K4ABT_JOINT_WRIST_LEFT
+    "HAND_LEFT",      // K4ABT_JOINT_HAND_LEFT
+    "HANDTIP_LEFT",   // K4ABT_JOINT_HANDTIP_LEFT
+    "THUMB_LEFT",     // K4ABT_JOINT_THUMB_LEFT
+    "CLAVICLE_RIGHT", // K4ABT_JOINT_CLAVICLE_RIGHT
+    "SHOULDER_RIGHT", // K4ABT_JOINT_SHOULDER_RIGHT
+    "ELBOW_RIGHT",    // K4ABT_JOINT_ELBOW_RIGHT
+    "WRIST_RIGHT",    // K4ABT_JOINT_WRIST_RIGHT
+    "HAND_RIGHT",     // K4ABT_JOINT_HAND_RIGHT
+    "HANDTIP_RIGHT",  // K4ABT_JOINT_HANDTIP_RIGHT
+    "THUMB_RIGHT",    // K4ABT_JOINT_THUMB_RIGHT
+    "HIP_LEFT",       // K4ABT_JOINT_HIP_LEFT
+    "KNEE_LEFT",      // K4ABT_JOINT_KNEE_LEFT
+    "ANKLE_LEFT",     // K4ABT_JOINT_ANKLE_LEFT
+    "FOOT_LEFT",      // K4ABT_JOINT_FOOT_LEFT
+    "HIP_RIGHT",      // K4ABT_JOINT_HIP_RIGHT
+    "KNEE_RIGHT",     // K4ABT_JOINT_KNEE_RIGHT
+    "ANKLE_RIGHT",    // K4ABT_JOINT_ANKLE_RIGHT
+    "FOOT_RIGHT",     // K4ABT_JOINT_FOOT_RIGHT
+    "HEAD",           // K4ABT_JOINT_HEAD
+    "NOSE",           // K4ABT_JOINT_NOSE
+    "EYE_LEFT",       // K4ABT_JOINT_EYE_LEFT
+    "EAR_LEFT",       // K4ABT_JOINT_EAR_LEFT
+    "EYE_RIGHT",      // K4ABT_JOINT_EYE_RIGHT
+    "EAR_RIGHT"       // K4ABT_JOINT_EAR_RIGHT
 };
 
+// Channel layout of the skeleton stream: joints in k4abt_joint_id_t order (the order of
+// g_jointNames), 7 channels per joint. Channel joint * 7 + k carries g_jointChannelSuffixes[k],
+// i.e. position x, y, z in mm followed by the orientation quaternion w, x, y, z.
+constexpr int g_channelsPerJoint = 7;
+constexpr std::array<const char*, g_channelsPerJoint> g_jointChannelSuffixes =
+{
+    "_posx", "_posy", "_posz", "_oriw", "_orix", "_oriy", "_oriz"
+};
+constexpr int g_skeletonChannelCount = K4ABT_JOINT_COUNT * g_channelsPerJoint;
+
 struct Color
 {
     float r = 1.f;
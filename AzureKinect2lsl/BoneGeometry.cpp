@@ -0,0 +1,189 @@
+#include "BoneGeometry.h"
+
+#include <math.h>
+#include <string>
+
+static constexpr int FindBone(k4abt_joint_id_t parent, k4abt_joint_id_t child)
+{
+    for (size_t bone = 0; bone < BONE_COUNT; bone++)
+    {
+        if (g_boneList[bone].first == parent && g_boneList[bone].second == child)
+        {
+            return (int)bone;
+        }
+    }
+    return -1;
+}
+
+// Each angle is measured between two bones of g_boneList and reported as offset + sign * angle,
+// so that every channel reads 0 in neutral stance
+struct JointAngleDefinition
+{
+    int bone_a;
+    int bone_b;
+    float offset = 0.0f;
+    float sign = 1.0f;
+};
+
+static constexpr JointAngleDefinition g_jointAngles[JOINT_ANGLE_COUNT] =
+{
+    { FindBone(K4ABT_JOINT_SHOULDER_LEFT, K4ABT_JOINT_ELBOW_LEFT), FindBone(K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_WRIST_LEFT) },
+    { FindBone(K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_ELBOW_RIGHT), FindBone(K4ABT_JOINT_ELBOW_RIGHT, K4ABT_JOINT_WRIST_RIGHT) },
+    { FindBone(K4ABT_JOINT_HIP_LEFT, K4ABT_JOINT_KNEE_LEFT), FindBone(K4ABT_JOINT_KNEE_LEFT, K4ABT_JOINT_ANKLE_LEFT) },
+    { FindBone(K4ABT_JOINT_HIP_RIGHT, K4ABT_JOINT_KNEE_RIGHT), FindBone(K4ABT_JOINT_KNEE_RIGHT, K4ABT_JOINT_ANKLE_RIGHT) },
+    { FindBone(K4ABT_JOINT_SPINE_CHEST, K4ABT_JOINT_SPINE_NAVEL), FindBone(K4ABT_JOINT_SHOULDER_LEFT, K4ABT_JOINT_ELBOW_LEFT) },
+    { FindBone(K4ABT_JOINT_SPINE_CHEST, K4ABT_JOINT_SPINE_NAVEL), FindBone(K4ABT_JOINT_SHOULDER_RIGHT, K4ABT_JOINT_ELBOW_RIGHT) },
+    { FindBone(K4ABT_JOINT_SPINE_NAVEL, K4ABT_JOINT_PELVIS), FindBone(K4ABT_JOINT_HIP_LEFT, K4ABT_JOINT_KNEE_LEFT) },
+    { FindBone(K4ABT_JOINT_SPINE_NAVEL, K4ABT_JOINT_PELVIS), FindBone(K4ABT_JOINT_HIP_RIGHT, K4ABT_JOINT_KNEE_RIGHT) },
+    // The thigh is square to the pelvis-to-hip bone in neutral stance and closes on it as the leg abducts
+    { FindBone(K4ABT_JOINT_PELVIS, K4ABT_JOINT_HIP_LEFT), FindBone(K4ABT_JOINT_HIP_LEFT, K4ABT_JOINT_KNEE_LEFT), 90.0f, -1.0f },
+    { FindBone(K4ABT_JOINT_PELVIS, K4ABT_JOINT_HIP_RIGHT), FindBone(K4ABT_JOINT_HIP_RIGHT, K4ABT_JOINT_KNEE_RIGHT), 90.0f, -1.0f },
+    { FindBone(K4ABT_JOINT_ELBOW_LEFT, K4ABT_JOINT_WRIST_LEFT), FindBone(K4ABT_JOINT_WRIST_LEFT, K4ABT_JOINT_HAND_LEFT) },
+    { FindBone(K4ABT_JOINT_ELBOW_RIGHT, K4ABT_JOINT_WRIST_RIGHT), FindBone(K4ABT_JOINT_WRIST_RIGHT, K4ABT_JOINT_HAND_RIGHT) },
+    // The foot is square to the shank in neutral stance and opens past 90 degrees as the toes come up
+    { FindBone(K4ABT_JOINT_KNEE_LEFT, K4ABT_JOINT_ANKLE_LEFT), FindBone(K4ABT_JOINT_ANKLE_LEFT, K4ABT_JOINT_FOOT_LEFT), -90.0f, 1.0f },
+    { FindBone(K4ABT_JOINT_KNEE_RIGHT, K4ABT_JOINT_ANKLE_RIGHT), FindBone(K4ABT_JOINT_ANKLE_RIGHT, K4ABT_JOINT_FOOT_RIGHT), -90.0f, 1.0f },
+    { FindBone(K4ABT_JOINT_SPINE_CHEST, K4ABT_JOINT_NECK), FindBone(K4ABT_JOINT_NECK, K4ABT_JOINT_HEAD) },
+    { FindBone(K4ABT_JOINT_SPINE_CHEST, K4ABT_JOINT_SPINE_NAVEL), FindBone(K4ABT_JOINT_SPINE_NAVEL, K4ABT_JOINT_PELVIS) }
+};
+
+const char* const g_jointAngleNames[JOINT_ANGLE_COUNT] =
+{
+    "ELBOW_LEFT_flexion",
+    "ELBOW_RIGHT_flexion",
+    "KNEE_LEFT_flexion",
+    "KNEE_RIGHT_flexion",
+    "SHOULDER_LEFT_elevation",
+    "SHOULDER_RIGHT_elevation",
+    "HIP_LEFT_flexion",
+    "HIP_RIGHT_flexion",
+    "HIP_LEFT_abduction",
+    "HIP_RIGHT_abduction",
+    "WRIST_LEFT_flexion",
+    "WRIST_RIGHT_flexion",
+    "ANKLE_LEFT_dorsiflexion",
+    "ANKLE_RIGHT_dorsiflexion",
+    "NECK_flexion",
+    "SPINE_flexion"
+};
+
+static constexpr bool AllAnglesDefined()
+{
+    for (const JointAngleDefinition& angle : g_jointAngles)
+    {
+        if (angle.bone_a < 0 || angle.bone_b < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(AllAnglesDefined(), "Every joint angle must be made of two bones in g_boneList");
+
+void ComputeBoneVectors(const float* joints, BoneVectors* bones)
+{
+    for (int lane = 0; lane < BONE_LANES; lane++)
+    {
+        const float* parent = joints + g_boneParents[lane] * g_channelsPerJoint;
+        const float* child = joints + g_boneChildren[lane] * g_channelsPerJoint;
+        bones->x[lane] = child[0] - parent[0];
+        bones->y[lane] = child[1] - parent[1];
+        bones->z[lane] = child[2] - parent[2];
+    }
+
+    for (int lane = 0; lane < BONE_LANES; lane++)
+    {
+        float length = sqrtf(bones->x[lane] * bones->x[lane] + bones->y[lane] * bones->y[lane] + bones->z[lane] * bones->z[lane]);
+        float inverse = 1.0f / length;
+        bones->x[lane] *= inverse;
+        bones->y[lane] *= inverse;
+        bones->z[lane] *= inverse;
+        bones->length[lane] = length;
+    }
+}
+
+void ComputeJointAngles(const BoneVectors& bones, float* angles)
+{
+    alignas(64) float ax[JOINT_ANGLE_COUNT], ay[JOINT_ANGLE_COUNT], az[JOINT_ANGLE_COUNT];
+    alignas(64) float bx[JOINT_ANGLE_COUNT], by[JOINT_ANGLE_COUNT], bz[JOINT_ANGLE_COUNT];
+    for (int angle = 0; angle < JOINT_ANGLE_COUNT; angle++)
+    {
+        const int a = g_jointAngles[angle].bone_a;
+        const int b = g_jointAngles[angle].bone_b;
+        ax[angle] = bones.x[a];
+        ay[angle] = bones.y[a];
+        az[angle] = bones.z[a];
+        bx[angle] = bones.x[b];
+        by[angle] = bones.y[b];
+        bz[angle] = bones.z[b];
+    }
+
+    alignas(64) float sine[JOINT_ANGLE_COUNT], cosine[JOINT_ANGLE_COUNT];
+    for (int angle = 0; angle < JOINT_ANGLE_COUNT; angle++)
+    {
+        float cx = ay[angle] * bz[angle] - az[angle] * by[angle];
+        float cy = az[angle] * bx[angle] - ax[angle] * bz[angle];
+        float cz = ax[angle] * by[angle] - ay[angle] * bx[angle];
+        sine[angle] = sqrtf(cx * cx + cy * cy + cz * cz);
+        cosine[angle] = ax[angle] * bx[angle] + ay[angle] * by[angle] + az[angle] * bz[angle];
+    }
+
+    const float degrees = 57.29577951f;
+    for (int angle = 0; angle < JOINT_ANGLE_COUNT; angle++)
+    {
+        angles[angle] = g_jointAngles[angle].offset + g_jointAngles[angle].sign * atan2f(sine[angle], cosine[angle]) * degrees;
+    }
+}
+
+lsl_streaminfo CreateJointAngleStreamInfo(const std::string& source_id, double nominal_srate, int body_slots)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-Angles", "MoCap", body_slots * JOINT_ANGLE_COUNT, nominal_srate,
+        cft_float32, (source_id + "-angles").c_str());
+
+    lsl_xml_ptr desc = lsl_get_desc(info);
+    lsl_append_child_value(desc, "manufacturer", "University of Groningen");
+    lsl_append_child_value(desc, "model", "Azure Kinect");
+    lsl_append_child_value(desc, "body_slots", std::to_string(body_slots).c_str());
+
+    lsl_xml_ptr chns = lsl_append_child(desc, "channels");
+    for (int slot = 0; slot < body_slots; slot++)
+    {
+        std::string prefix = body_slots > 1 ? "BODY" + std::to_string(slot + 1) + "_" : "";
+        for (const char* angle_name : g_jointAngleNames)
+        {
+            lsl_xml_ptr channel = lsl_append_child(chns, "channel");
+            lsl_append_child_value(channel, "name", (prefix + angle_name).c_str());
+            lsl_append_child_value(channel, "unit", "degrees");
+        }
+    }
+    return info;
+}
+
+lsl_streaminfo CreateBoneVectorStreamInfo(const std::string& source_id, double nominal_srate, int body_slots)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-Bones", "MoCap", body_slots * BONE_VECTOR_CHANNEL_COUNT, nominal_srate,
+        cft_float32, (source_id + "-bones").c_str());
+
+    lsl_xml_ptr desc = lsl_get_desc(info);
+    lsl_append_child_value(desc, "manufacturer", "University of Groningen");
+    lsl_append_child_value(desc, "model", "Azure Kinect");
+    lsl_append_child_value(desc, "body_slots", std::to_string(body_slots).c_str());
+
+    const char* suffixes[3] = { "_dirx", "_diry", "_dirz" };
+    lsl_xml_ptr chns = lsl_append_child(desc, "channels");
+    for (int slot = 0; slot < body_slots; slot++)
+    {
+        std::string prefix = body_slots > 1 ? "BODY" + std::to_string(slot + 1) + "_" : "";
+        for (const auto& bone : g_boneList)
+        {
+            std::string bone_name = prefix + g_jointNames[bone.first] + "-" + g_jointNames[bone.second];
+            for (const char* suffix : suffixes)
+            {
+                lsl_xml_ptr channel = lsl_append_child(chns, "channel");
+                lsl_append_child_value(channel, "name", (bone_name + suffix).c_str());
+                lsl_append_child_value(channel, "unit", "unit vector");
+            }
+        }
+    }
+    return info;
+}
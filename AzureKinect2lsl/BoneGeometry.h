@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <lsl_cpp.h>
+#include "BodyTrackingHelpers.h"
+
+// Bones are processed in lanes of 32 so every loop covers whole SIMD registers; lane 31 is padding
+#define BONE_COUNT 31
+#define BONE_LANES 32
+
+// Angles on the joint angle stream, listed in g_jointAngleNames
+#define JOINT_ANGLE_COUNT 16
+
+#define BONE_VECTOR_CHANNEL_COUNT (BONE_COUNT * 3)
+
+static_assert(g_boneList.size() == BONE_COUNT, "BONE_COUNT must match g_boneList");
+
+// Joint indices of every bone lane. The padding lane repeats the first bone so it never produces NaN.
+constexpr std::array<uint8_t, BONE_LANES> MakeBoneJointIndices(bool child)
+{
+    std::array<uint8_t, BONE_LANES> indices = {};
+    for (size_t lane = 0; lane < BONE_LANES; lane++)
+    {
+        const auto& bone = g_boneList[lane < BONE_COUNT ? lane : 0];
+        indices[lane] = (uint8_t)(child ? bone.second : bone.first);
+    }
+    return indices;
+}
+
+constexpr std::array<uint8_t, BONE_LANES> g_boneParents = MakeBoneJointIndices(false);
+constexpr std::array<uint8_t, BONE_LANES> g_boneChildren = MakeBoneJointIndices(true);
+
+// Unit direction (parent to child) and length in mm of every bone in g_boneList, as structure-of-arrays
+struct alignas(64) BoneVectors
+{
+    float x[BONE_LANES];
+    float y[BONE_LANES];
+    float z[BONE_LANES];
+    float length[BONE_LANES];
+};
+
+// Channel names of the joint angle stream, in stream order
+extern const char* const g_jointAngleNames[JOINT_ANGLE_COUNT];
+
+/**
+ * Computes the bone vectors of a packed skeleton (layout documented next to g_jointNames).
+ * Parent and child joint indices are compile-time arrays derived from g_boneList, and the
+ * differences and normalisation are straight loops over the bone lanes that the compiler
+ * turns into SIMD. A bone with a NaN joint gets a NaN direction and length.
+ */
+void ComputeBoneVectors(const float* joints, BoneVectors* bones);
+
+/**
+ * Computes the anatomical angles in degrees from the angle between two bone directions, each
+ * 0 in neutral stance: elbow, knee and wrist flexion, shoulder elevation and hip flexion against
+ * the trunk, hip abduction against the pelvis (negative for adduction), ankle dorsiflexion
+ * (negative for plantarflexion), neck and trunk flexion.
+ * Uses atan2(|a x b|, a . b), which stays accurate near 0 and 180 degrees where acos does not.
+ */
+void ComputeJointAngles(const BoneVectors& bones, float* angles);
+
+// Stream info for the joint angles: JOINT_ANGLE_COUNT channels in degrees per body slot
+lsl_streaminfo CreateJointAngleStreamInfo(const std::string& source_id, double nominal_srate, int body_slots);
+
+// Stream info for the bone directions: x, y, z of every bone in g_boneList per body slot
+lsl_streaminfo CreateBoneVectorStreamInfo(const std::string& source_id, double nominal_srate, int body_slots);
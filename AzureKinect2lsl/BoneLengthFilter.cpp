@@ -0,0 +1,96 @@
+#include "BoneLengthFilter.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include "BodyTrackingHelpers.h"
+
+// Measurements an estimate needs before outliers are rejected, and how far off an outlier is
+#define BONE_LENGTH_MIN_SAMPLES 10
+#define BONE_LENGTH_OUTLIER_RATIO 0.3f
+
+// The filter places each bone's child relative to its parent, so every parent has to be placed first
+static constexpr bool BonesOrderedFromChest()
+{
+    bool placed[K4ABT_JOINT_COUNT] = {};
+    placed[K4ABT_JOINT_SPINE_CHEST] = true;
+    for (const auto& bone : g_boneList)
+    {
+        if (!placed[bone.first])
+        {
+            return false;
+        }
+        placed[bone.second] = true;
+    }
+    return true;
+}
+static_assert(BonesOrderedFromChest(), "g_boneList must list every bone after the bone leading to its parent");
+
+BoneLengthFilter::BoneLengthFilter(int body_slots)
+    : m_slots(std::min(std::max(body_slots, 1), MAX_BODY_SLOTS))
+{
+}
+
+void BoneLengthFilter::Clear(int slot, float* out)
+{
+    m_slots[slot].body_id = K4ABT_INVALID_BODY_ID;
+    std::fill(out, out + g_skeletonChannelCount, std::numeric_limits<float>::quiet_NaN());
+}
+
+void BoneLengthFilter::Apply(int slot, uint32_t body_id, const float* joints, const uint8_t* confidence, float* out)
+{
+    SlotEstimate& estimate = m_slots[slot];
+    if (estimate.body_id != body_id)
+    {
+        estimate.body_id = body_id;
+        std::fill(estimate.length, estimate.length + BONE_LANES, 0.0f);
+        std::fill(estimate.samples, estimate.samples + BONE_LANES, 0u);
+        std::fill(estimate.rejections, estimate.rejections + BONE_LANES, 0u);
+    }
+
+    BoneVectors bones;
+    ComputeBoneVectors(joints, &bones);
+
+    for (int bone = 0; bone < BONE_COUNT; bone++)
+    {
+        const float length = bones.length[bone];
+        if (confidence[g_boneParents[bone]] < K4ABT_JOINT_CONFIDENCE_MEDIUM ||
+            confidence[g_boneChildren[bone]] < K4ABT_JOINT_CONFIDENCE_MEDIUM || !(length > 0.0f))
+        {
+            continue;
+        }
+        uint32_t samples = estimate.samples[bone];
+        if (samples >= BONE_LENGTH_MIN_SAMPLES && fabsf(length - estimate.length[bone]) > BONE_LENGTH_OUTLIER_RATIO * estimate.length[bone])
+        {
+            // A body entering the view can give a biased start that would otherwise reject every
+            // correct length for as long as the body is tracked
+            if (++estimate.rejections[bone] < BONE_LENGTH_MAX_REJECTIONS)
+            {
+                continue;
+            }
+            samples = 0;
+        }
+        estimate.rejections[bone] = 0;
+        const uint32_t weight = std::min<uint32_t>(samples + 1, BONE_LENGTH_WINDOW);
+        estimate.length[bone] += (length - estimate.length[bone]) / weight;
+        estimate.samples[bone] = samples + 1;
+    }
+
+    // Orientations and the chest are copied as they are; the rest is rebuilt along the bones.
+    // A child whose parent is NaN (gated by confidence) keeps its measured position and anchors
+    // its own subtree, so one missing joint does not wipe out the joints beyond it.
+    std::copy(joints, joints + g_skeletonChannelCount, out);
+    for (int bone = 0; bone < BONE_COUNT; bone++)
+    {
+        const float* parent = out + g_boneParents[bone] * g_channelsPerJoint;
+        float* child = out + g_boneChildren[bone] * g_channelsPerJoint;
+        if (isnan(parent[0]))
+        {
+            continue;
+        }
+        const float length = estimate.samples[bone] > 0 ? estimate.length[bone] : bones.length[bone];
+        child[0] = parent[0] + bones.x[bone] * length;
+        child[1] = parent[1] + bones.y[bone] * length;
+        child[2] = parent[2] + bones.z[bone] * length;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "BodySlots.h"
+#include "BoneGeometry.h"
+
+// Measurements after which a bone length estimate stops being a plain mean and starts to track slowly
+#define BONE_LENGTH_WINDOW 100
+
+// Outliers in a row after which a bone's estimate is taken to be wrong and restarted (a second at 30 fps)
+#define BONE_LENGTH_MAX_REJECTIONS 30
+
+/**
+ * Estimates the bone lengths of the body in each slot online and rebuilds every frame with those
+ * lengths.
+ * Estimates only take bones whose two joints were measured (confidence medium or better): a
+ * running mean over the first BONE_LENGTH_WINDOW measurements, then an exponential average with
+ * the same window. Once a bone has a few measurements, outliers beyond 30% are ignored; if
+ * BONE_LENGTH_MAX_REJECTIONS come in a row, the early measurements were the outliers and the
+ * estimate restarts from the latest one.
+ * The filter walks g_boneList from SPINE_CHEST outwards, keeping the chest where the tracker put
+ * it and placing every child along its measured bone direction at the estimated length, so the
+ * pose and the joint orientations are unchanged and only the bone lengths are made constant.
+ * A joint that is NaN stays NaN, and its measured children are rebuilt from where they were measured.
+ */
+class BoneLengthFilter
+{
+public:
+    explicit BoneLengthFilter(int body_slots);
+
+    // Updates the estimates of the slot's body from the packed skeleton and writes the constrained
+    // skeleton, in the same layout, to out. A new body in the slot starts with fresh estimates.
+    void Apply(int slot, uint32_t body_id, const float* joints, const uint8_t* confidence, float* out);
+
+    // Forgets the slot's estimates and writes NaN, for slots without a body
+    void Clear(int slot, float* out);
+
+private:
+    struct SlotEstimate
+    {
+        uint32_t body_id = K4ABT_INVALID_BODY_ID;
+        float length[BONE_LANES];
+        uint32_t samples[BONE_LANES];
+        uint32_t rejections[BONE_LANES]; // Outliers in a row
+    };
+
+    std::vector<SlotEstimate> m_slots;
+};
@@ -0,0 +1,34 @@
+#include "CaptureSource.h"
+
+capture_result_t GetNextCapture(const CaptureSource& source, int32_t timeout_ms, k4a_capture_t* capture)
+{
+    if (source.playback == NULL)
+    {
+        switch (k4a_device_get_capture(source.device, capture, timeout_ms))
+        {
+        case K4A_WAIT_RESULT_SUCCEEDED: return CAPTURE_RESULT_SUCCEEDED;
+        case K4A_WAIT_RESULT_TIMEOUT:   return CAPTURE_RESULT_TIMEOUT;
+        default:                        return CAPTURE_RESULT_FAILED;
+        }
+    }
+
+    while (true)
+    {
+        k4a_stream_result_t result = k4a_playback_get_next_capture(source.playback, capture);
+        if (result == K4A_STREAM_RESULT_EOF)
+        {
+            return CAPTURE_RESULT_END_OF_FILE;
+        }
+        if (result != K4A_STREAM_RESULT_SUCCEEDED)
+        {
+            return CAPTURE_RESULT_FAILED;
+        }
+        k4a_image_t depth_image = k4a_capture_get_depth_image(*capture);
+        if (depth_image != NULL)
+        {
+            k4a_image_release(depth_image);
+            return CAPTURE_RESULT_SUCCEEDED;
+        }
+        k4a_capture_release(*capture);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <k4a/k4a.h>
+#include <k4arecord/playback.h>
+
+// Where the pipeline's captures come from: a live device or a recording, whichever is set.
+struct CaptureSource
+{
+    k4a_device_t device = NULL;
+    k4a_playback_t playback = NULL;
+};
+
+typedef enum
+{
+    CAPTURE_RESULT_SUCCEEDED = 0,
+    CAPTURE_RESULT_TIMEOUT,     // Nothing yet from the device
+    CAPTURE_RESULT_END_OF_FILE, // The recording has no more captures with depth
+    CAPTURE_RESULT_FAILED
+} capture_result_t;
+
+/**
+ * Gets the next capture. A device waits up to timeout_ms for it; a recording returns at once, as
+ * fast as it can be read, skipping captures that only hold a color or IR image because the tracker
+ * needs depth.
+ */
+capture_result_t GetNextCapture(const CaptureSource& source, int32_t timeout_ms, k4a_capture_t* capture);
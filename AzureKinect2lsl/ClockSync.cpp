@@ -0,0 +1,173 @@
+#include "ClockSync.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// Frames per second the forgetting factor is tuned for
+#define CLOCK_MODEL_FPS 30.0
+// Observations needed before late arrivals are rejected
+#define CLOCK_MODEL_MIN_OBSERVATIONS 30
+// Arrivals later than predicted by more than this are treated as queued, not fresh
+#define CLOCK_MODEL_MAX_LATENESS 0.05
+
+const char* GetTimestampSourceName(timestamp_source_t source)
+{
+    switch (source)
+    {
+    case TIMESTAMP_SOURCE_DEVICE: return "device";
+    case TIMESTAMP_SOURCE_SYSTEM: return "system";
+    case TIMESTAMP_SOURCE_POP:    return "pop";
+    default:                      return "unknown";
+    }
+}
+
+uint64_t GetCaptureDeviceTimestampUsec(k4a_capture_t capture)
+{
+    k4a_image_t depth_image = k4a_capture_get_depth_image(capture);
+    if (depth_image == NULL)
+    {
+        return 0;
+    }
+    uint64_t device_usec = k4a_image_get_device_timestamp_usec(depth_image);
+    k4a_image_release(depth_image);
+    return device_usec;
+}
+
+bool GetCaptureTimestamp(k4a_capture_t capture, timestamp_source_t source, double* seconds)
+{
+    k4a_image_t depth_image = k4a_capture_get_depth_image(capture);
+    if (depth_image == NULL)
+    {
+        return false;
+    }
+    if (source == TIMESTAMP_SOURCE_SYSTEM)
+    {
+        *seconds = k4a_image_get_system_timestamp_nsec(depth_image) * 1e-9;
+    }
+    else
+    {
+        *seconds = k4a_image_get_device_timestamp_usec(depth_image) * 1e-6;
+    }
+    k4a_image_release(depth_image);
+    return true;
+}
+
+ClockModel::ClockModel(double window_seconds)
+    : m_decay(1.0 - 1.0 / (window_seconds * CLOCK_MODEL_FPS))
+{
+}
+
+void ClockModel::AddObservation(double source_time, double lsl_time)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasOrigin)
+    {
+        m_originSource = source_time;
+        m_originLsl = lsl_time;
+        m_hasOrigin = true;
+    }
+
+    double x = source_time - m_originSource;
+    double y = lsl_time - m_originLsl;
+    if (m_observations >= CLOCK_MODEL_MIN_OBSERVATIONS)
+    {
+        double intercept, slope;
+        Fit(&intercept, &slope);
+        if (y - (intercept + slope * x) > CLOCK_MODEL_MAX_LATENESS)
+        {
+            return;
+        }
+    }
+
+    m_w = m_w * m_decay + 1;
+    m_sx = m_sx * m_decay + x;
+    m_sy = m_sy * m_decay + y;
+    m_sxx = m_sxx * m_decay + x * x;
+    m_sxy = m_sxy * m_decay + x * y;
+    m_observations++;
+}
+
+// Weighted least squares in origin-relative coordinates. Until the observations span some time
+// the slope is taken as 1 and only the mean offset is fitted.
+void ClockModel::Fit(double* intercept, double* slope) const
+{
+    if (m_w == 0)
+    {
+        *intercept = 0;
+        *slope = 1;
+        return;
+    }
+
+    double denominator = m_w * m_sxx - m_sx * m_sx;
+    if (m_observations < 2 || fabs(denominator) < 1e-9 * m_w * m_w)
+    {
+        *slope = 1;
+    }
+    else
+    {
+        *slope = (m_w * m_sxy - m_sx * m_sy) / denominator;
+    }
+    *intercept = (m_sy - *slope * m_sx) / m_w;
+}
+
+double ClockModel::ToLslTime(double source_time) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double intercept, slope;
+    Fit(&intercept, &slope);
+    return m_originLsl + intercept + slope * (source_time - m_originSource);
+}
+
+void ClockModel::GetFit(double* offset, double* slope, uint64_t* observations) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    double intercept;
+    Fit(&intercept, slope);
+    *offset = m_originLsl + intercept - *slope * m_originSource;
+    *observations = m_observations;
+}
+
+void WarmUpClockModel(k4a_device_t device, timestamp_source_t source, int captures, ClockModel& model)
+{
+    for (int i = 0; i < captures; i++)
+    {
+        k4a_capture_t sensor_capture;
+        if (k4a_device_get_capture(device, &sensor_capture, 1000) != K4A_WAIT_RESULT_SUCCEEDED)
+        {
+            continue;
+        }
+        double arrival = lsl_local_clock();
+        double source_time;
+        if (GetCaptureTimestamp(sensor_capture, source, &source_time))
+        {
+            model.AddObservation(source_time, arrival);
+        }
+        k4a_capture_release(sensor_capture);
+    }
+}
+
+void AppendClockSyncMetadata(lsl_streaminfo info, timestamp_source_t source, const ClockModel& model)
+{
+    lsl_xml_ptr clock_sync = lsl_append_child(lsl_get_desc(info), "clock_sync");
+    lsl_append_child_value(clock_sync, "timestamp_source", GetTimestampSourceName(source));
+    if (source == TIMESTAMP_SOURCE_POP)
+    {
+        return;
+    }
+
+    double offset, slope;
+    uint64_t observations;
+    model.GetFit(&offset, &slope, &observations);
+
+    char value[64];
+    lsl_append_child_value(clock_sync, "method", "online weighted linear regression of capture timestamp against arrival time");
+    lsl_append_child_value(clock_sync, "model", "lsl_time = offset + slope * source_time_seconds");
+    snprintf(value, sizeof(value), "%.9f", offset);
+    lsl_append_child_value(clock_sync, "offset", value);
+    snprintf(value, sizeof(value), "%.12f", slope);
+    lsl_append_child_value(clock_sync, "slope", value);
+    snprintf(value, sizeof(value), "%.3f", (slope - 1.0) * 1e6);
+    lsl_append_child_value(clock_sync, "drift_ppm", value);
+    snprintf(value, sizeof(value), "%llu", (unsigned long long)observations);
+    lsl_append_child_value(clock_sync, "observations", value);
+}
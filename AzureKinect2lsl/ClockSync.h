@@ -0,0 +1,61 @@
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <k4a/k4a.h>
+#include <lsl_cpp.h>
+
+// Which clock a skeleton sample's timestamp is derived from.
+typedef enum
+{
+    TIMESTAMP_SOURCE_DEVICE = 0, // Depth camera device timestamp, mapped onto the LSL clock
+    TIMESTAMP_SOURCE_SYSTEM,     // Host system timestamp recorded by the SDK, mapped onto the LSL clock
+    TIMESTAMP_SOURCE_POP,        // lsl_local_clock() when the body frame is popped (includes tracker latency)
+    TIMESTAMP_SOURCE_COUNT
+} timestamp_source_t;
+
+const char* GetTimestampSourceName(timestamp_source_t source);
+
+// Device timestamp of the capture's depth image in microseconds, 0 if it has none.
+uint64_t GetCaptureDeviceTimestampUsec(k4a_capture_t capture);
+
+// Timestamp of the capture's depth image on the chosen clock, in seconds. Returns false if the
+// capture has no depth image.
+bool GetCaptureTimestamp(k4a_capture_t capture, timestamp_source_t source, double* seconds);
+
+/**
+ * Online linear model lsl_time = offset + slope * source_time, fitted by exponentially weighted
+ * least squares on (capture timestamp, lsl_local_clock() at arrival) pairs. Arrival includes USB
+ * and driver latency; the regression averages out its jitter, and observations arriving far later
+ * than predicted (e.g. captures that sat in the device queue) are rejected.
+ * Observations come from the capture thread, mappings from the tracker thread.
+ */
+class ClockModel
+{
+public:
+    explicit ClockModel(double window_seconds = 30.0);
+
+    void AddObservation(double source_time, double lsl_time);
+    double ToLslTime(double source_time) const;
+
+    // offset in seconds, slope in LSL seconds per source second (1 + drift)
+    void GetFit(double* offset, double* slope, uint64_t* observations) const;
+
+private:
+    void Fit(double* intercept, double* slope) const;
+
+    const double m_decay;
+    mutable std::mutex m_mutex;
+    bool m_hasOrigin = false;
+    double m_originSource = 0; // Observations are stored relative to the first one to keep precision
+    double m_originLsl = 0;
+    double m_w = 0, m_sx = 0, m_sy = 0, m_sxx = 0, m_sxy = 0;
+    uint64_t m_observations = 0;
+};
+
+// Feeds the model from the device for about the given number of captures so the stream metadata
+// can carry a fit. The captures are discarded.
+void WarmUpClockModel(k4a_device_t device, timestamp_source_t source, int captures, ClockModel& model);
+
+// Adds a <clock_sync> node describing the timestamp source and the current fit to the stream description.
+void AppendClockSyncMetadata(lsl_streaminfo info, timestamp_source_t source, const ClockModel& model);
@@ -0,0 +1,268 @@
+#include "DeviceStreamer.h"
+
+#include <memory>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <lsl_cpp.h>
+#include <k4a/k4a.h>
+#include <k4abt.h>
+#include "BodyTrackingHelpers.h"
+#include "SkeletonFusion.h"
+#include "SkeletonPipeline.h"
+#include "SkeletonStream.h"
+#include "StopSignal.h"
+
+#define CLOCK_WARMUP_CAPTURES 60
+#define FUSED_NOMINAL_SRATE 30 // The cameras run at K4A_FRAMES_PER_SECOND_30
+
+int StreamDevice(const DeviceSession& session, const StreamerOptions& options)
+{
+    k4a_device_t device = session.device;
+    const std::string source_id = GetDeviceSourceId(device, session.device_index);
+    const bool master = session.wired_sync_mode == K4A_WIRED_SYNC_MODE_MASTER;
+
+    // Start camera. Make sure depth camera is enabled.
+    k4a_device_configuration_t deviceConfig = K4A_DEVICE_CONFIG_INIT_DISABLE_ALL;
+    deviceConfig.depth_mode = K4A_DEPTH_MODE_NFOV_2X2BINNED; // K4A_DEPTH_MODE_NFOV_UNBINNED;
+    deviceConfig.color_resolution = K4A_COLOR_RESOLUTION_OFF;
+    deviceConfig.camera_fps = K4A_FRAMES_PER_SECOND_30;
+    ApplySyncConfig(session.wired_sync_mode, session.device_index, options.sync, deviceConfig);
+
+    if (master && session.start_gate != NULL && !session.start_gate->WaitForOthers())
+    {
+        printf("%s: not every subordinate started in time, starting the master anyway\n", source_id.c_str());
+    }
+    const bool started = k4a_device_start_cameras(device, &deviceConfig) == K4A_RESULT_SUCCEEDED;
+    if (session.start_gate != NULL)
+    {
+        session.start_gate->Arrive();
+    }
+    if (!started)
+    {
+        printf("%s: start K4A cameras failed!\n", source_id.c_str());
+        k4a_device_close(device);
+        return -1;
+    }
+    if (session.wired_sync_mode != K4A_WIRED_SYNC_MODE_STANDALONE)
+    {
+        printf("%s: wired sync %s, %u us behind the master, depth %d us off color\n", source_id.c_str(),
+            master ? "master" : "subordinate", deviceConfig.subordinate_delay_off_master_usec, deviceConfig.depth_delay_off_color_usec);
+    }
+
+    k4a_calibration_t sensor_calibration;
+    if (k4a_device_get_calibration(device, deviceConfig.depth_mode, deviceConfig.color_resolution, &sensor_calibration) != K4A_RESULT_SUCCEEDED)
+    {
+        printf("%s: get depth camera calibration failed!\n", source_id.c_str());
+        k4a_device_stop_cameras(device);
+        k4a_device_close(device);
+        return -1;
+    }
+
+    // Every device gets a tracker of its own; the CPU fallback is per device too, since a second
+    // tracker may not fit on the GPU next to the first
+    k4abt_tracker_t tracker = NULL;
+    k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT;
+    tracker_config.processing_mode = K4ABT_TRACKER_PROCESSING_MODE_GPU_CUDA;
+
+    lsl_streaminfo info = NULL;
+    if (k4abt_tracker_create(&sensor_calibration, tracker_config, &tracker) != K4A_RESULT_SUCCEEDED)
+    {
+        printf("%s: CUDA body tracker initialization failed!\n", source_id.c_str());
+        tracker_config.processing_mode = K4ABT_TRACKER_PROCESSING_MODE_CPU;
+        if (k4abt_tracker_create(&sensor_calibration, tracker_config, &tracker) != K4A_RESULT_SUCCEEDED)
+        {
+            printf("%s: body tracker initialization failed!\n", source_id.c_str());
+            k4a_device_stop_cameras(device);
+            k4a_device_close(device);
+            return -1;
+        }
+        printf("%s: running tracker is standard (slow) mode\n", source_id.c_str());
+        info = CreateSkeletonStreamInfo(source_id, 4, options.pipeline.body_slots, options.stream);
+    }
+    else
+    {
+        printf("%s: running tracker is CUDA mode\n", source_id.c_str());
+        info = CreateSkeletonStreamInfo(source_id, 10, options.pipeline.body_slots, options.stream);
+    }
+    printf("%s: streaming %d %s channels\n", source_id.c_str(), options.pipeline.body_slots * g_skeletonChannelCount,
+        GetChannelFormatName(options.stream.channel_format));
+    k4abt_tracker_set_temporal_smoothing(tracker, options.sdk_smoothing);
+    AppendSmoothingMetadata(info, (options.pipeline.smoothed_outlets & (1u << SMOOTHED_OUTLET_SKELETON)) != 0,
+        options.pipeline.smoothing, options.sdk_smoothing);
+
+    // Fit the capture clock against the LSL clock for a moment so the metadata carries the mapping
+    ClockModel clock_model;
+    if (options.pipeline.timestamp_source != TIMESTAMP_SOURCE_POP)
+    {
+        WarmUpClockModel(device, options.pipeline.timestamp_source, CLOCK_WARMUP_CAPTURES, clock_model);
+    }
+    AppendClockSyncMetadata(info, options.pipeline.timestamp_source, clock_model);
+    AppendSyncMetadata(info, deviceConfig);
+
+    lsl_outlet outlet = CreateSkeletonOutlet(info, options.stream);
+    BodyOutletPool body_outlets(source_id, options.stream.body_outlets ? options.pipeline.body_slots : 0,
+        lsl_get_nominal_srate(info), options.stream);
+    printf("%s: waiting for recorder\n", source_id.c_str());
+    // A recorder of the fused stream alone needs every device's pipeline running as well
+    while (!lsl_wait_for_consumers(outlet, 1) && !(session.fused_outlet != NULL && lsl_have_consumers(session.fused_outlet)) &&
+        !IsStopRequested()); // Poll so Ctrl+C is honoured
+    printf("%s: now sending data...\n", source_id.c_str());
+
+    int result = 0;
+    {
+        CaptureSource source;
+        source.device = device;
+        SkeletonPipeline pipeline(source, tracker, sensor_calibration, outlet, &clock_model, &body_outlets, options.pipeline);
+        if (session.frame_sets != NULL)
+        {
+            session.frame_sets->SetDevice(session.frame_set_device, source_id, deviceConfig.subordinate_delay_off_master_usec);
+            pipeline.AttachFrameSets(session.frame_sets, session.frame_set_device);
+        }
+        result = pipeline.Run();
+    }
+    printf("%s: finished body tracking processing!\n", source_id.c_str());
+
+    lsl_destroy_outlet(outlet);
+    k4abt_tracker_destroy(tracker);
+    k4a_device_stop_cameras(device);
+    k4a_device_close(device);
+    return result;
+}
+
+int StreamDevices(const std::vector<uint32_t>& device_indices, const StreamerOptions& options)
+{
+    std::vector<DeviceSession> sessions;
+    for (uint32_t device_index : device_indices)
+    {
+        DeviceSession session = {};
+        session.device_index = device_index;
+        if (k4a_device_open(device_index, &session.device) != K4A_RESULT_SUCCEEDED)
+        {
+            printf("Open K4A device %u failed!\n", device_index);
+            for (const DeviceSession& opened : sessions)
+            {
+                k4a_device_close(opened.device);
+            }
+            return -1;
+        }
+        session.wired_sync_mode = ResolveWiredSyncMode(session.device, options.sync.mode);
+        session.frame_set_device = (int)sessions.size();
+        sessions.push_back(session);
+    }
+
+    // A master starts after the others; the device timestamps only share a clock if every device is wired
+    bool any_master = false;
+    bool all_wired = true;
+    for (const DeviceSession& session : sessions)
+    {
+        any_master |= session.wired_sync_mode == K4A_WIRED_SYNC_MODE_MASTER;
+        all_wired &= session.wired_sync_mode != K4A_WIRED_SYNC_MODE_STANDALONE;
+    }
+    std::unique_ptr<SyncStartGate> start_gate;
+    if (any_master && sessions.size() > 1)
+    {
+        start_gate.reset(new SyncStartGate((int)sessions.size()));
+    }
+    std::unique_ptr<FrameSetCollector> frame_sets;
+    if (options.frame_sets && sessions.size() > 1)
+    {
+        if (sessions.size() > FRAME_SET_MAX_DEVICES)
+        {
+            printf("Frame sets take at most %d devices; the others stream on their own\n", FRAME_SET_MAX_DEVICES);
+        }
+        FrameSetConfig config = options.frame_set;
+        if (options.frame_set_tolerance_usec <= 0)
+        {
+            config.tolerance_usec = all_wired ? FRAME_SET_SYNC_TOLERANCE_USEC : FRAME_SET_FREE_TOLERANCE_USEC;
+        }
+        else
+        {
+            config.tolerance_usec = options.frame_set_tolerance_usec;
+        }
+        frame_sets.reset(new FrameSetCollector((int)sessions.size(), config, all_wired));
+    }
+    else if (options.frame_sets)
+    {
+        printf("--frame-sets and --fuse need at least two devices and are ignored\n");
+    }
+
+    // The fused stream is named after all of its devices, so its source_id stays stable across restarts
+    std::unique_ptr<SkeletonFusion> fusion;
+    lsl_outlet fused_outlet = NULL;
+    if (frame_sets && options.fuse)
+    {
+        std::vector<std::string> source_ids;
+        std::string fused_id;
+        for (size_t i = 0; i < sessions.size() && i < FRAME_SET_MAX_DEVICES; i++)
+        {
+            source_ids.push_back(GetDeviceSourceId(sessions[i].device, sessions[i].device_index));
+            fused_id += (i > 0 ? "+" : "") + source_ids.back();
+        }
+        std::vector<Extrinsics> extrinsics(source_ids.size());
+        if (options.extrinsics == NULL)
+        {
+            printf("No --extrinsics given: every camera's frame is taken as the world frame\n");
+        }
+        else if (!LoadExtrinsics(options.extrinsics, source_ids, extrinsics))
+        {
+            for (const DeviceSession& session : sessions)
+            {
+                k4a_device_close(session.device);
+            }
+            return -1;
+        }
+        fusion.reset(new SkeletonFusion(extrinsics, options.pipeline.body_slots));
+        lsl_streaminfo info = CreateFusedStreamInfo(fused_id, FUSED_NOMINAL_SRATE, fusion->GetSlotCount());
+        AppendFusionMetadata(info, source_ids, extrinsics);
+        fused_outlet = CreateSkeletonOutlet(info, options.stream);
+        frame_sets->AttachFusion(fusion.get(), fused_outlet);
+    }
+    if (frame_sets)
+    {
+        frame_sets->Start();
+    }
+    for (DeviceSession& session : sessions)
+    {
+        session.start_gate = start_gate.get();
+        session.frame_sets = session.frame_set_device < FRAME_SET_MAX_DEVICES ? frame_sets.get() : NULL;
+        session.fused_outlet = session.frame_sets != NULL ? fused_outlet : NULL;
+    }
+
+    std::vector<int> results(sessions.size(), 0);
+    if (sessions.size() == 1)
+    {
+        results[0] = StreamDevice(sessions[0], options);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(sessions.size());
+        for (size_t i = 0; i < sessions.size(); i++)
+        {
+            threads.emplace_back([&, i]() { results[i] = StreamDevice(sessions[i], options); });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    if (frame_sets)
+    {
+        frame_sets->Stop();
+        frame_sets->PrintSummary();
+    }
+    if (fused_outlet != NULL)
+    {
+        lsl_destroy_outlet(fused_outlet);
+    }
+    for (int result : results)
+    {
+        if (result != 0)
+        {
+            return result;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <lsl_cpp.h>
+#include <k4a/k4a.h>
+#include "DeviceSync.h"
+#include "FrameSetCollector.h"
+#include "Options.h"
+
+// One device of a session, opened by StreamDevices
+struct DeviceSession
+{
+    k4a_device_t device;
+    uint32_t device_index;
+    k4a_wired_sync_mode_t wired_sync_mode;
+    SyncStartGate* start_gate;     // NULL unless a master has to start after the other devices
+    FrameSetCollector* frame_sets; // NULL unless the devices' frames are assembled into sets
+    int frame_set_device;          // This device's index in the frame sets
+    lsl_outlet fused_outlet;       // NULL unless the frame sets are fused; a consumer of it starts the device too
+};
+
+/**
+ * Streams the session's device until the session ends: the device's own tracker, outlets and
+ * SkeletonPipeline, with every stream's source_id taken from GetDeviceSourceId. Waits until the
+ * device's skeleton stream or the fused stream has a consumer before streaming. Closes the device.
+ * Returns the pipeline's result, or -1 if the cameras or the tracker could not be set up.
+ */
+int StreamDevice(const DeviceSession& session, const StreamerOptions& options);
+
+/**
+ * Opens these devices, resolves their wired sync modes and streams each from a thread of its own,
+ * so the devices share nothing but the stop signal, the start order a sync master needs and the
+ * optional frame set collector. Every device runs a complete pipeline at its own rate.
+ * Returns 0 if every device finished cleanly, otherwise the first failure in device order.
+ */
+int StreamDevices(const std::vector<uint32_t>& device_indices, const StreamerOptions& options);
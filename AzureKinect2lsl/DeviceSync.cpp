@@ -0,0 +1,104 @@
+#include "DeviceSync.h"
+
+#include <chrono>
+#include <string>
+
+const char* GetSyncModeName(sync_mode_t mode)
+{
+    switch (mode)
+    {
+    case SYNC_MODE_OFF:         return "off";
+    case SYNC_MODE_AUTO:        return "auto";
+    case SYNC_MODE_MASTER:      return "master";
+    case SYNC_MODE_SUBORDINATE: return "subordinate";
+    default:                    return "unknown";
+    }
+}
+
+static const char* GetWiredSyncModeName(k4a_wired_sync_mode_t mode)
+{
+    switch (mode)
+    {
+    case K4A_WIRED_SYNC_MODE_MASTER:      return "master";
+    case K4A_WIRED_SYNC_MODE_SUBORDINATE: return "subordinate";
+    default:                              return "standalone";
+    }
+}
+
+k4a_wired_sync_mode_t ResolveWiredSyncMode(k4a_device_t device, sync_mode_t mode)
+{
+    switch (mode)
+    {
+    case SYNC_MODE_MASTER:
+        return K4A_WIRED_SYNC_MODE_MASTER;
+    case SYNC_MODE_SUBORDINATE:
+        return K4A_WIRED_SYNC_MODE_SUBORDINATE;
+    case SYNC_MODE_AUTO:
+    {
+        bool sync_in = false;
+        bool sync_out = false;
+        if (k4a_device_get_sync_jack(device, &sync_in, &sync_out) != K4A_RESULT_SUCCEEDED)
+        {
+            return K4A_WIRED_SYNC_MODE_STANDALONE;
+        }
+        if (sync_in)
+        {
+            return K4A_WIRED_SYNC_MODE_SUBORDINATE;
+        }
+        return sync_out ? K4A_WIRED_SYNC_MODE_MASTER : K4A_WIRED_SYNC_MODE_STANDALONE;
+    }
+    default:
+        return K4A_WIRED_SYNC_MODE_STANDALONE;
+    }
+}
+
+uint32_t GetSubordinateDelayUsec(k4a_wired_sync_mode_t wired_mode, uint32_t device_index, const SyncConfig& config)
+{
+    if (wired_mode != K4A_WIRED_SYNC_MODE_SUBORDINATE)
+    {
+        return 0;
+    }
+    // A subordinate at index 0 is driven by a master on another host; it still needs its own slot
+    return config.subordinate_delay_usec * (device_index > 0 ? device_index : 1);
+}
+
+void ApplySyncConfig(k4a_wired_sync_mode_t wired_mode, uint32_t device_index, const SyncConfig& config,
+    k4a_device_configuration_t& device_config)
+{
+    device_config.wired_sync_mode = wired_mode;
+    device_config.subordinate_delay_off_master_usec = GetSubordinateDelayUsec(wired_mode, device_index, config);
+    device_config.depth_delay_off_color_usec = config.depth_delay_off_color_usec;
+    if ((wired_mode == K4A_WIRED_SYNC_MODE_MASTER || config.depth_delay_off_color_usec != 0) &&
+        device_config.color_resolution == K4A_COLOR_RESOLUTION_OFF)
+    {
+        device_config.color_format = K4A_IMAGE_FORMAT_COLOR_MJPG;
+        device_config.color_resolution = K4A_COLOR_RESOLUTION_720P;
+    }
+}
+
+void AppendSyncMetadata(lsl_streaminfo info, const k4a_device_configuration_t& device_config)
+{
+    lsl_xml_ptr sync = lsl_append_child(lsl_get_desc(info), "sync");
+    lsl_append_child_value(sync, "wired_sync_mode", GetWiredSyncModeName(device_config.wired_sync_mode));
+    lsl_append_child_value(sync, "subordinate_delay_off_master_usec", std::to_string(device_config.subordinate_delay_off_master_usec).c_str());
+    lsl_append_child_value(sync, "depth_delay_off_color_usec", std::to_string(device_config.depth_delay_off_color_usec).c_str());
+}
+
+SyncStartGate::SyncStartGate(int device_count)
+    : m_deviceCount(device_count)
+{
+}
+
+void SyncStartGate::Arrive()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_arrivedCount++;
+    m_arrived.notify_all();
+}
+
+bool SyncStartGate::WaitForOthers()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_arrived.wait_for(lock, std::chrono::milliseconds(SYNC_START_TIMEOUT_MS),
+        [this]() { return m_arrivedCount >= m_deviceCount - 1; });
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <k4a/k4a.h>
+#include <lsl_cpp.h>
+
+#define SYNC_SUBORDINATE_SPACING_USEC 160 // Keeps the depth lasers of neighbouring subordinates apart
+#define SYNC_START_TIMEOUT_MS 10000       // How long a master waits for the other devices' cameras
+#define SYNC_MAX_DEPTH_DELAY_USEC 33333   // The SDK accepts at most one frame period at 30 fps
+
+// How a device takes part in wired (3.5 mm jack) synchronization.
+typedef enum
+{
+    SYNC_MODE_OFF = 0,     // Free running
+    SYNC_MODE_AUTO,        // Subordinate if the sync in jack is connected, master if only sync out is, else free running
+    SYNC_MODE_MASTER,      // Drives the sync out jack
+    SYNC_MODE_SUBORDINATE, // Triggered by the sync in jack
+    SYNC_MODE_COUNT
+} sync_mode_t;
+
+const char* GetSyncModeName(sync_mode_t mode);
+
+struct SyncConfig
+{
+    sync_mode_t mode = SYNC_MODE_OFF;
+    uint32_t subordinate_delay_usec = SYNC_SUBORDINATE_SPACING_USEC; // Per device index off the master
+    int32_t depth_delay_off_color_usec = 0;
+};
+
+// The wired sync mode for this device under the configured mode, reading the jacks for SYNC_MODE_AUTO
+k4a_wired_sync_mode_t ResolveWiredSyncMode(k4a_device_t device, sync_mode_t mode);
+
+// The subordinate_delay_off_master_usec of the device at this index: a multiple of the configured
+// delay, so no two subordinates fire their depth lasers at once. 0 for a master or free running device.
+uint32_t GetSubordinateDelayUsec(k4a_wired_sync_mode_t wired_mode, uint32_t device_index, const SyncConfig& config);
+
+/**
+ * Fills in the sync fields of the device configuration. The SDK only accepts master mode and a
+ * depth delay with the color camera running, so those turn on the smallest MJPG color stream
+ * unless color is already configured.
+ */
+void ApplySyncConfig(k4a_wired_sync_mode_t wired_mode, uint32_t device_index, const SyncConfig& config,
+    k4a_device_configuration_t& device_config);
+
+// Adds a <sync> node with the wired sync mode and delays to the stream description
+void AppendSyncMetadata(lsl_streaminfo info, const k4a_device_configuration_t& device_config);
+
+/**
+ * A subordinate only sees the master's first pulse if its own cameras run by then, so the master
+ * starts last. Every device arrives once its cameras have started (or failed to); the master waits
+ * until all the others have, or until SYNC_START_TIMEOUT_MS so a miscabled rig cannot hang.
+ */
+class SyncStartGate
+{
+public:
+    explicit SyncStartGate(int device_count);
+
+    void Arrive();
+    // Returns false on a timeout
+    bool WaitForOthers();
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_arrived;
+    int m_deviceCount;
+    int m_arrivedCount = 0;
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define FRAME_SET_MAX_DEVICES 8
+
+// How frames of several devices are matched into sets.
+struct FrameSetConfig
+{
+    int64_t tolerance_usec = 1000;  // Frames this close to the oldest frame of a set belong to it
+    int64_t max_wait_usec = 100000; // Stop waiting for a device once another has delivered frames this much newer
+    size_t max_pending = 8;         // Frames held per device; a further frame drops the oldest
+    int min_devices = 2;            // Sets with fewer devices are dropped instead of emitted
+};
+
+struct FrameSetStats
+{
+    uint64_t complete;         // Sets with a frame from every device
+    uint64_t partial;          // Sets emitted with some devices missing
+    uint64_t dropped_late;     // Frames that arrived after their set had gone, or out of order
+    uint64_t dropped_overflow; // Frames pushed out of a full device queue
+    uint64_t dropped_orphan;   // Frames whose set did not reach min_devices
+};
+
+// One aligned set: the frame of every device that has one, NULL for the others.
+// The frames point into the assembler and stay valid until Pop.
+template <typename Frame>
+struct FrameSet
+{
+    int64_t timestamp_usec; // Timestamp of the oldest frame in the set
+    int64_t spread_usec;    // Newest minus oldest frame timestamp
+    int device_count;       // Devices with a frame in the set
+    const Frame* frames[FRAME_SET_MAX_DEVICES];
+    int64_t timestamps_usec[FRAME_SET_MAX_DEVICES];
+};
+
+/**
+ * Matches the frames of several devices by timestamp. Each device's frames queue up in arrival
+ * order; a set is formed around the oldest queued frame from the head of every queue within the
+ * tolerance. A set is emitted as soon as every device has a frame in it. A device that has
+ * skipped the set, or delivered nothing for max_wait_usec of the other devices' timestamps, is
+ * left out and the set is emitted partial, or dropped below min_devices.
+ * Timestamps must share one clock, and each device's must increase; what is expected of a device
+ * (such as its subordinate delay) is subtracted before the frame is added.
+ * Storage is allocated once in the constructor, so memory stays bounded however far a device falls
+ * behind. The assembler does not lock and never looks at the wall clock, so a recorded or
+ * synthetic timestamp sequence replays exactly.
+ */
+template <typename Frame>
+class FrameSetAssembler
+{
+public:
+    FrameSetAssembler(int device_count, const FrameSetConfig& config)
+        : m_config(config), m_deviceCount(std::min(std::max(device_count, 1), FRAME_SET_MAX_DEVICES)),
+          m_capacity(std::max<size_t>(config.max_pending, 1))
+    {
+        m_frames.reset(new Frame[m_deviceCount * m_capacity]);
+        m_timestamps.resize(m_deviceCount * m_capacity);
+        m_queues.resize(m_deviceCount);
+    }
+
+    int GetDeviceCount() const { return m_deviceCount; }
+    FrameSetStats GetStats() const { return m_stats; }
+
+    // Returns the slot to fill with the device's next frame, or NULL (and counts it late) if the
+    // frame is not newer than the device's last one or than the last set that went out.
+    // A full queue drops its oldest frame to make room.
+    Frame* BeginAdd(int device, int64_t timestamp_usec)
+    {
+        Queue& queue = m_queues[device];
+        if ((queue.seen && timestamp_usec <= queue.last_usec) || (m_released && timestamp_usec <= m_releasedUsec))
+        {
+            m_stats.dropped_late++;
+            return NULL;
+        }
+        if (queue.count == m_capacity)
+        {
+            queue.head = (queue.head + 1) % m_capacity;
+            queue.count--;
+            m_stats.dropped_overflow++;
+        }
+        const size_t index = device * m_capacity + (queue.head + queue.count) % m_capacity;
+        m_timestamps[index] = timestamp_usec;
+        return &m_frames[index];
+    }
+
+    // Queues the frame filled since the last BeginAdd of this device
+    void CommitAdd(int device)
+    {
+        Queue& queue = m_queues[device];
+        const int64_t timestamp_usec = m_timestamps[device * m_capacity + (queue.head + queue.count) % m_capacity];
+        queue.count++;
+        queue.last_usec = timestamp_usec;
+        queue.seen = true;
+        m_newestUsec = m_anySeen ? std::max(m_newestUsec, timestamp_usec) : timestamp_usec;
+        m_anySeen = true;
+    }
+
+    // Finds the next set to emit, dropping orphaned frames on the way. Returns false while the set
+    // around the oldest frame still waits for a device. Calling it again before Pop finds the same set;
+    // adding a frame in between can invalidate it.
+    bool Front(FrameSet<Frame>& set)
+    {
+        while (true)
+        {
+            int64_t anchor_usec = 0;
+            bool any = false;
+            for (int device = 0; device < m_deviceCount; device++)
+            {
+                if (m_queues[device].count > 0 && (!any || HeadUsec(device) < anchor_usec))
+                {
+                    anchor_usec = HeadUsec(device);
+                    any = true;
+                }
+            }
+            if (!any)
+            {
+                return false;
+            }
+
+            const int64_t window_end = anchor_usec + m_config.tolerance_usec;
+            const bool expired = m_newestUsec - anchor_usec > m_config.max_wait_usec;
+            bool waiting = false;
+            set.timestamp_usec = anchor_usec;
+            set.spread_usec = 0;
+            set.device_count = 0;
+            for (int device = 0; device < FRAME_SET_MAX_DEVICES; device++)
+            {
+                set.frames[device] = NULL;
+                if (device >= m_deviceCount)
+                {
+                    continue;
+                }
+                const Queue& queue = m_queues[device];
+                if (queue.count > 0 && HeadUsec(device) <= window_end)
+                {
+                    set.frames[device] = &m_frames[device * m_capacity + queue.head];
+                    set.timestamps_usec[device] = HeadUsec(device);
+                    set.spread_usec = std::max(set.spread_usec, HeadUsec(device) - anchor_usec);
+                    set.device_count++;
+                }
+                else if (queue.count == 0 && !(queue.seen && queue.last_usec > window_end))
+                {
+                    // Nothing queued, and nothing yet that has passed the set: the frame may still come
+                    waiting = true;
+                }
+            }
+
+            if (set.device_count == m_deviceCount || (set.device_count >= m_config.min_devices && (!waiting || expired)))
+            {
+                return true;
+            }
+            if (waiting && !expired)
+            {
+                return false;
+            }
+            m_stats.dropped_orphan += set.device_count;
+            Release(set);
+        }
+    }
+
+    // Releases the set found by Front
+    void Pop(const FrameSet<Frame>& set)
+    {
+        if (set.device_count == m_deviceCount)
+        {
+            m_stats.complete++;
+        }
+        else
+        {
+            m_stats.partial++;
+        }
+        Release(set);
+    }
+
+private:
+    struct Queue
+    {
+        size_t head = 0;
+        size_t count = 0;
+        int64_t last_usec = 0;
+        bool seen = false;
+    };
+
+    int64_t HeadUsec(int device) const
+    {
+        return m_timestamps[device * m_capacity + m_queues[device].head];
+    }
+
+    void Release(const FrameSet<Frame>& set)
+    {
+        for (int device = 0; device < m_deviceCount; device++)
+        {
+            if (set.frames[device] != NULL)
+            {
+                m_queues[device].head = (m_queues[device].head + 1) % m_capacity;
+                m_queues[device].count--;
+            }
+        }
+        m_releasedUsec = set.timestamp_usec;
+        m_released = true;
+    }
+
+    FrameSetConfig m_config;
+    int m_deviceCount;
+    size_t m_capacity;
+    std::unique_ptr<Frame[]> m_frames; // m_capacity per device, each device's used as a ring
+    std::vector<int64_t> m_timestamps;
+    std::vector<Queue> m_queues;
+    FrameSetStats m_stats = {};
+    int64_t m_newestUsec = 0;
+    bool m_anySeen = false;
+    int64_t m_releasedUsec = 0;
+    bool m_released = false;
+};
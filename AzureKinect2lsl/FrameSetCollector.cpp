@@ -0,0 +1,154 @@
+#include "FrameSetCollector.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "SkeletonFusion.h"
+#include "SkeletonPipeline.h"
+
+FrameSetCollector::FrameSetCollector(int device_count, const FrameSetConfig& config, bool device_clock)
+    : m_deviceClock(device_clock), m_sourceIds(device_count), m_offsetsUsec(device_count, 0),
+      m_assembler(device_count, config), m_setFrames(m_assembler.GetDeviceCount())
+{
+}
+
+FrameSetCollector::~FrameSetCollector()
+{
+    Stop();
+}
+
+void FrameSetCollector::SetDevice(int device, const std::string& source_id, uint32_t subordinate_delay_usec)
+{
+    m_sourceIds[device] = source_id;
+    m_offsetsUsec[device] = subordinate_delay_usec;
+}
+
+void FrameSetCollector::AttachFusion(SkeletonFusion* fusion, lsl_outlet outlet)
+{
+    m_fusion = fusion;
+    m_fusedOutlet = outlet;
+    m_fusedData.resize(fusion->GetSlotCount() * g_skeletonChannelCount);
+    m_fusedFrames.resize(m_assembler.GetDeviceCount());
+}
+
+void FrameSetCollector::Start()
+{
+    m_thread = std::thread(&FrameSetCollector::AssembleLoop, this);
+}
+
+void FrameSetCollector::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_added.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void FrameSetCollector::Add(int device, const SkeletonRecord& record, int body_slots)
+{
+    if (device < 0 || device >= m_assembler.GetDeviceCount())
+    {
+        return;
+    }
+    const int64_t timestamp_usec = m_deviceClock ? (int64_t)record.device_usec - m_offsetsUsec[device] : llround(record.timestamp * 1e6);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        DeviceFrame* frame = m_assembler.BeginAdd(device, timestamp_usec);
+        if (frame == NULL)
+        {
+            return;
+        }
+        frame->timestamp = record.timestamp;
+        frame->device_usec = record.device_usec;
+        frame->body_slots = body_slots;
+        memcpy(frame->body_ids, record.body_ids, body_slots * sizeof(uint32_t));
+        memcpy(frame->joints, record.joints, body_slots * g_skeletonChannelCount * sizeof(float));
+        memcpy(frame->confidence, record.confidence, body_slots * K4ABT_JOINT_COUNT);
+        m_assembler.CommitAdd(device);
+    }
+    m_added.notify_one();
+}
+
+void FrameSetCollector::AssembleLoop()
+{
+    FrameSet<DeviceFrame> set;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop)
+    {
+        if (!m_assembler.Front(set))
+        {
+            m_added.wait(lock);
+            continue;
+        }
+        for (int device = 0; device < m_assembler.GetDeviceCount(); device++)
+        {
+            if (set.frames[device] != NULL)
+            {
+                m_setFrames[device] = *set.frames[device];
+                set.frames[device] = &m_setFrames[device];
+            }
+        }
+        m_assembler.Pop(set);
+
+        lock.unlock();
+        ProcessSet(set);
+        lock.lock();
+    }
+}
+
+// Downstream of the assembler: every aligned set passes through here
+void FrameSetCollector::ProcessSet(const FrameSet<DeviceFrame>& set)
+{
+    m_spread.Record(set.spread_usec * 1e-6);
+    if (m_fusion == NULL)
+    {
+        return;
+    }
+
+    // The fused sample takes the mean capture time of the frames it was made from
+    double started = lsl_local_clock();
+    double timestamp = 0;
+    for (int device = 0; device < m_assembler.GetDeviceCount(); device++)
+    {
+        m_fusedFrames[device] = set.frames[device];
+        timestamp += set.frames[device] != NULL ? set.frames[device]->timestamp : 0.0;
+    }
+    uint32_t body_ids[MAX_BODY_SLOTS];
+    m_fusedBodiesLeftOut += m_fusion->Fuse(m_fusedFrames.data(), m_assembler.GetDeviceCount(), m_fusedData.data(), body_ids);
+    m_fusionTime.Record(lsl_local_clock() - started);
+    lsl_push_sample_ft(m_fusedOutlet, m_fusedData.data(), timestamp / set.device_count);
+    m_fusedSets++;
+}
+
+void FrameSetCollector::PrintSummary() const
+{
+    FrameSetStats stats = m_assembler.GetStats();
+    LatencySnapshot spread;
+    m_spread.Snapshot(&spread);
+    printf("Frame sets of %d devices (%s clock):\n", m_assembler.GetDeviceCount(), m_deviceClock ? "device" : "LSL");
+    for (size_t device = 0; device < m_sourceIds.size(); device++)
+    {
+        printf("  device %zu: %s, %lld us behind the master\n", device, m_sourceIds[device].c_str(), (long long)m_offsetsUsec[device]);
+    }
+    printf("  %llu complete, %llu partial; dropped frames: %llu late, %llu overflow, %llu orphaned\n",
+        (unsigned long long)stats.complete, (unsigned long long)stats.partial, (unsigned long long)stats.dropped_late,
+        (unsigned long long)stats.dropped_overflow, (unsigned long long)stats.dropped_orphan);
+    if (spread.count > 0)
+    {
+        printf("  timestamp spread within a set: mean %.0f us, p99 %.0f us\n", spread.MeanMs() * 1000, spread.PercentileMs(99) * 1000);
+    }
+    if (m_fusion != NULL)
+    {
+        LatencySnapshot fusion_time;
+        m_fusionTime.Snapshot(&fusion_time);
+        printf("  fused %llu sets, mean %.0f us, p99 %.0f us per set; %llu bodies left out because all %d slots were taken\n",
+            (unsigned long long)m_fusedSets, fusion_time.MeanMs() * 1000, fusion_time.PercentileMs(99) * 1000,
+            (unsigned long long)m_fusedBodiesLeftOut, m_fusion->GetSlotCount());
+    }
+}
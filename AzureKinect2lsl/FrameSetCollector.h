@@ -0,0 +1,86 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <k4abttypes.h>
+#include <lsl_cpp.h>
+#include "BodySlots.h"
+#include "BodyTrackingHelpers.h"
+#include "FrameSetAssembler.h"
+#include "LatencyHistogram.h"
+
+#define FRAME_SET_SYNC_TOLERANCE_USEC 1000  // Default for wired sync, where device timestamps share the master's clock
+#define FRAME_SET_FREE_TOLERANCE_USEC 16000 // Default for free running devices: just under half a 30 fps frame
+
+struct SkeletonRecord;
+class SkeletonFusion;
+
+// One device's skeletons of one frame, as they wait for the frames of the other devices
+struct DeviceFrame
+{
+    double timestamp;     // On the LSL clock
+    uint64_t device_usec;
+    int body_slots;
+    uint32_t body_ids[MAX_BODY_SLOTS];
+    float joints[MAX_BODY_SLOTS * g_skeletonChannelCount];
+    uint8_t confidence[MAX_BODY_SLOTS * K4ABT_JOINT_COUNT];
+};
+
+/**
+ * Collects the tracked frames of every device's pipeline and assembles them into aligned frame
+ * sets on a thread of its own. With wired sync the device timestamps share the master's clock once
+ * each subordinate's delay is taken off; free running devices are matched on the LSL timestamps.
+ * The tracker threads only copy their frame in under a short lock, and the assembler's bounded
+ * queues drop stale and orphaned frames, so a device that falls behind never stalls the others.
+ * Every set can be fused into a single skeleton sample, processed outside the lock.
+ */
+class FrameSetCollector
+{
+public:
+    FrameSetCollector(int device_count, const FrameSetConfig& config, bool device_clock);
+    ~FrameSetCollector();
+
+    // Call before the device's pipeline starts
+    void SetDevice(int device, const std::string& source_id, uint32_t subordinate_delay_usec);
+    // Fuses every set into one skeleton sample on this outlet. Call before Start.
+    void AttachFusion(SkeletonFusion* fusion, lsl_outlet outlet);
+    void Start();
+    // Stops the assembler thread once the pipelines are done; sets still waiting are dropped
+    void Stop();
+
+    // Tracker threads: hands over a frame of the device's pipeline
+    void Add(int device, const SkeletonRecord& record, int body_slots);
+
+    void PrintSummary() const;
+
+private:
+    void AssembleLoop();
+    void ProcessSet(const FrameSet<DeviceFrame>& set);
+
+    bool m_deviceClock;
+    std::vector<std::string> m_sourceIds;
+    std::vector<int64_t> m_offsetsUsec;
+
+    std::mutex m_mutex; // Guards the assembler
+    std::condition_variable m_added;
+    FrameSetAssembler<DeviceFrame> m_assembler;
+    bool m_stop = false;
+    std::thread m_thread;
+
+    // A set copied out of the assembler, so processing never holds the lock
+    std::vector<DeviceFrame> m_setFrames;
+    LatencyHistogram m_spread;
+
+    // Optional fusion of every set, on the assembler thread
+    SkeletonFusion* m_fusion = NULL;
+    lsl_outlet m_fusedOutlet = NULL;
+    std::vector<float> m_fusedData;
+    std::vector<const DeviceFrame*> m_fusedFrames;
+    LatencyHistogram m_fusionTime;
+    uint64_t m_fusedSets = 0;
+    uint64_t m_fusedBodiesLeftOut = 0;
+};
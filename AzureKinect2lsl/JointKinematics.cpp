@@ -0,0 +1,127 @@
+#include "JointKinematics.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include "BodyTrackingHelpers.h"
+
+JointKinematics::JointKinematics(int body_slots)
+    : m_slots(std::min(std::max(body_slots, 1), MAX_BODY_SLOTS))
+{
+}
+
+void JointKinematics::Clear(int slot, float* out)
+{
+    m_slots[slot].count = 0;
+    m_slots[slot].body_id = K4ABT_INVALID_BODY_ID;
+    std::fill(out, out + KINEMATICS_CHANNEL_COUNT, std::numeric_limits<float>::quiet_NaN());
+}
+
+void JointKinematics::Update(int slot, uint32_t body_id, const float* joints, uint64_t device_usec, float* out)
+{
+    SlotHistory& history = m_slots[slot];
+    if (history.count > 0 && (body_id != history.body_id || device_usec <= history.device_usec[history.newest] ||
+        device_usec - history.device_usec[history.newest] > KINEMATICS_MAX_GAP_USEC))
+    {
+        history.count = 0;
+    }
+    history.body_id = body_id;
+
+    // Transpose the packed joints into the next ring entry
+    const int newest = (history.newest + 1) % 3;
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        history.position[newest][0][joint] = joints[joint * g_channelsPerJoint + 0];
+        history.position[newest][1][joint] = joints[joint * g_channelsPerJoint + 1];
+        history.position[newest][2][joint] = joints[joint * g_channelsPerJoint + 2];
+    }
+    history.device_usec[newest] = device_usec;
+    history.newest = newest;
+    history.count = std::min(history.count + 1, 3);
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    alignas(CACHE_LINE_SIZE) float velocity[3][K4ABT_JOINT_COUNT];
+    alignas(CACHE_LINE_SIZE) float acceleration[3][K4ABT_JOINT_COUNT];
+    if (history.count < 2)
+    {
+        std::fill(&velocity[0][0], &velocity[0][0] + 3 * K4ABT_JOINT_COUNT, nan);
+    }
+    if (history.count < 3)
+    {
+        std::fill(&acceleration[0][0], &acceleration[0][0] + 3 * K4ABT_JOINT_COUNT, nan);
+    }
+
+    if (history.count >= 2)
+    {
+        const int previous = (newest + 2) % 3;
+        const float inverse_dt = 1e6f / (float)(device_usec - history.device_usec[previous]);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float* p2 = history.position[newest][axis];
+            const float* p1 = history.position[previous][axis];
+            float* v = velocity[axis];
+            for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+            {
+                v[joint] = (p2[joint] - p1[joint]) * inverse_dt;
+            }
+        }
+
+        if (history.count == 3)
+        {
+            const int oldest = (newest + 1) % 3;
+            const float inverse_previous_dt = 1e6f / (float)(history.device_usec[previous] - history.device_usec[oldest]);
+            const float inverse_half_span = 2e6f / (float)(device_usec - history.device_usec[oldest]);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const float* p1 = history.position[previous][axis];
+                const float* p0 = history.position[oldest][axis];
+                const float* v = velocity[axis];
+                float* a = acceleration[axis];
+                for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+                {
+                    a[joint] = (v[joint] - (p1[joint] - p0[joint]) * inverse_previous_dt) * inverse_half_span;
+                }
+            }
+        }
+    }
+
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        float* channels = out + joint * KINEMATICS_CHANNELS_PER_JOINT;
+        channels[0] = velocity[0][joint];
+        channels[1] = velocity[1][joint];
+        channels[2] = velocity[2][joint];
+        channels[3] = acceleration[0][joint];
+        channels[4] = acceleration[1][joint];
+        channels[5] = acceleration[2][joint];
+    }
+}
+
+lsl_streaminfo CreateKinematicsStreamInfo(const std::string& source_id, double nominal_srate, int body_slots)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-Kinematics", "MoCap", body_slots * KINEMATICS_CHANNEL_COUNT,
+        nominal_srate, cft_float32, (source_id + "-kinematics").c_str());
+
+    lsl_xml_ptr desc = lsl_get_desc(info);
+    lsl_append_child_value(desc, "manufacturer", "University of Groningen");
+    lsl_append_child_value(desc, "model", "Azure Kinect");
+    lsl_append_child_value(desc, "body_slots", std::to_string(body_slots).c_str());
+
+    const char* suffixes[KINEMATICS_CHANNELS_PER_JOINT] = { "_velx", "_vely", "_velz", "_accx", "_accy", "_accz" };
+    const char* units[KINEMATICS_CHANNELS_PER_JOINT] = { "mm/s", "mm/s", "mm/s", "mm/s^2", "mm/s^2", "mm/s^2" };
+    lsl_xml_ptr chns = lsl_append_child(desc, "channels");
+    for (int slot = 0; slot < body_slots; slot++)
+    {
+        std::string prefix = body_slots > 1 ? "BODY" + std::to_string(slot + 1) + "_" : "";
+        for (const char* joint_name : g_jointNames)
+        {
+            for (int k = 0; k < KINEMATICS_CHANNELS_PER_JOINT; k++)
+            {
+                lsl_xml_ptr channel = lsl_append_child(chns, "channel");
+                lsl_append_child_value(channel, "name", (prefix + joint_name + suffixes[k]).c_str());
+                lsl_append_child_value(channel, "unit", units[k]);
+            }
+        }
+    }
+    return info;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <lsl_cpp.h>
+#include <k4abttypes.h>
+#include "BodySlots.h"
+#include "SpscRing.h"
+
+// Velocity x, y, z in mm/s followed by acceleration x, y, z in mm/s^2, per joint
+#define KINEMATICS_CHANNELS_PER_JOINT 6
+#define KINEMATICS_CHANNEL_COUNT (K4ABT_JOINT_COUNT * KINEMATICS_CHANNELS_PER_JOINT)
+
+// Frames further apart than this (a body lost and found again) restart the history
+#define KINEMATICS_MAX_GAP_USEC 250000
+
+/**
+ * Per-joint velocity and acceleration from finite differences over the last three frames of each
+ * body slot, using device timestamps so dropped frames stretch the time step instead of skewing
+ * the result. Velocity is the backward difference of the two newest frames; acceleration is the
+ * difference of the two most recent velocities over half the three-frame span.
+ * History is kept as structure-of-arrays, one 32-float row per coordinate, so every step is a
+ * straight loop over all joints that the compiler turns into SIMD.
+ */
+class JointKinematics
+{
+public:
+    explicit JointKinematics(int body_slots);
+
+    // Adds the packed skeleton (layout documented next to g_jointNames) of the body in the slot and
+    // writes KINEMATICS_CHANNEL_COUNT values to out. Values that need more history than the slot has
+    // are NaN, as are joints whose position is NaN.
+    void Update(int slot, uint32_t body_id, const float* joints, uint64_t device_usec, float* out);
+
+    // Forgets the slot's history and writes NaN, for slots without a body
+    void Clear(int slot, float* out);
+
+private:
+    struct alignas(CACHE_LINE_SIZE) SlotHistory
+    {
+        float position[3][3][K4ABT_JOINT_COUNT]; // [frame in ring][axis][joint]
+        uint64_t device_usec[3];
+        int newest = -1;
+        int count = 0;
+        uint32_t body_id = K4ABT_INVALID_BODY_ID;
+    };
+
+    std::vector<SlotHistory> m_slots;
+};
+
+// Stream info for the kinematics: KINEMATICS_CHANNEL_COUNT float channels per body slot, named
+// <JOINT>_velx .. <JOINT>_accz with the BODY<slot>_ prefix when there is more than one slot.
+lsl_streaminfo CreateKinematicsStreamInfo(const std::string& source_id, double nominal_srate, int body_slots);
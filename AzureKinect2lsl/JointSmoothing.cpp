@@ -0,0 +1,223 @@
+#include "JointSmoothing.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include "BodyTrackingHelpers.h"
+
+static const float TWO_PI = 6.2831853f;
+
+const char* GetSmoothedOutletName(smoothed_outlet_t outlet)
+{
+    switch (outlet)
+    {
+    case SMOOTHED_OUTLET_SKELETON:    return "skeleton";
+    case SMOOTHED_OUTLET_BODIES:      return "bodies";
+    case SMOOTHED_OUTLET_KINEMATICS:  return "kinematics";
+    case SMOOTHED_OUTLET_GEOMETRY:    return "geometry";
+    case SMOOTHED_OUTLET_CONSTRAINED: return "constrained";
+    default:                          return "unknown";
+    }
+}
+
+// Weight of the new sample in an exponential filter with this cutoff, for a time step of dt seconds
+static inline float SmoothingAlpha(float dt, float cutoff_hz)
+{
+    const float r = TWO_PI * cutoff_hz * dt;
+    return r / (r + 1.0f);
+}
+
+// acos on [0, 1] to within 7e-5 rad (Abramowitz and Stegun 4.4.45), and sin(x) / x on [0, pi/2] to
+// within 3e-6; polynomials instead of libm calls so the orientation loop vectorizes. The dot product
+// of two unit quaternions can round to just above 1, which the fabsf absorbs without a clamp.
+static inline float AcosUnit(float x)
+{
+    return sqrtf(fabsf(1.0f - x)) * (1.5707288f + x * (-0.2121144f + x * (0.0742610f - 0.0187293f * x)));
+}
+
+static inline float SincQuarterTurn(float x)
+{
+    const float x2 = x * x;
+    return 1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880))));
+}
+
+JointSmoother::JointSmoother(int body_slots, const SmoothingConfig& config)
+    : m_config(config), m_slots(std::min(std::max(body_slots, 1), MAX_BODY_SLOTS))
+{
+    for (SlotState& state : m_slots)
+    {
+        Reset(state);
+    }
+}
+
+void JointSmoother::Reset(SlotState& state)
+{
+    // Zeros rather than NaN, so the filter loops never see NaN in the state
+    memset(&state, 0, sizeof(state));
+    state.body_id = K4ABT_INVALID_BODY_ID;
+}
+
+void JointSmoother::Clear(int slot, float* out)
+{
+    Reset(m_slots[slot]);
+    std::fill(out, out + g_skeletonChannelCount, std::numeric_limits<float>::quiet_NaN());
+}
+
+void JointSmoother::Apply(int slot, uint32_t body_id, const float* joints, uint64_t device_usec, float* out)
+{
+    SlotState& state = m_slots[slot];
+    if (body_id != state.body_id || device_usec <= state.device_usec || device_usec - state.device_usec > SMOOTHING_MAX_GAP_USEC)
+    {
+        Reset(state);
+        state.body_id = body_id;
+    }
+    // A fresh state has no time step yet; any positive value works because fresh joints take the sample as it is
+    const float dt = state.device_usec > 0 ? (float)(device_usec - state.device_usec) * 1e-6f : 1.0f;
+    state.device_usec = device_usec;
+    const float derivative_alpha = SmoothingAlpha(dt, m_config.derivative_cutoff_hz);
+    const float inverse_dt = 1.0f / dt;
+
+    // Transpose the packed joints into rows. A missing (NaN) joint takes its filtered state as input,
+    // which leaves the state as it is, and gets NaN back on the way out. That keeps NaN out of the
+    // filter loops, where every per-joint decision is a select, so they run over all joints in SIMD lanes.
+    alignas(CACHE_LINE_SIZE) float position[3][K4ABT_JOINT_COUNT];
+    alignas(CACHE_LINE_SIZE) float orientation[4][K4ABT_JOINT_COUNT];
+    alignas(CACHE_LINE_SIZE) float present[2][K4ABT_JOINT_COUNT]; // 1 or 0, for position and orientation
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        const float* channels = joints + joint * g_channelsPerJoint;
+        const bool position_missing = channels[0] != channels[0];
+        const bool orientation_missing = channels[3] != channels[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            position[axis][joint] = position_missing ? state.position[axis][joint] : channels[axis];
+        }
+        for (int k = 0; k < 4; k++)
+        {
+            orientation[k][joint] = orientation_missing ? state.orientation[k][joint] : channels[3 + k];
+        }
+        present[0][joint] = position_missing ? 0.0f : 1.0f;
+        present[1][joint] = orientation_missing ? 0.0f : 1.0f;
+    }
+
+    // Positions: One Euro filter on each joint, with the cutoff driven by the joint's filtered speed
+    float* px = state.position[0];
+    float* py = state.position[1];
+    float* pz = state.position[2];
+    float* vx = state.velocity[0];
+    float* vy = state.velocity[1];
+    float* vz = state.velocity[2];
+    float* seen = state.position_seen;
+    const float position_min_cutoff_hz = m_config.position_min_cutoff_hz;
+    const float position_beta = m_config.position_beta;
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        const float fresh = 1.0f - seen[joint];
+        const float x = position[0][joint], y = position[1][joint], z = position[2][joint];
+
+        const float fvx = vx[joint] + derivative_alpha * ((x - px[joint]) * inverse_dt - vx[joint]);
+        const float fvy = vy[joint] + derivative_alpha * ((y - py[joint]) * inverse_dt - vy[joint]);
+        const float fvz = vz[joint] + derivative_alpha * ((z - pz[joint]) * inverse_dt - vz[joint]);
+        const float speed = sqrtf(fvx * fvx + fvy * fvy + fvz * fvz);
+        const float alpha = SmoothingAlpha(dt, position_min_cutoff_hz + position_beta * speed);
+        // A fresh joint starts at its raw position and at rest
+        const float fx = px[joint] + (alpha + fresh * (1.0f - alpha)) * (x - px[joint]);
+        const float fy = py[joint] + (alpha + fresh * (1.0f - alpha)) * (y - py[joint]);
+        const float fz = pz[joint] + (alpha + fresh * (1.0f - alpha)) * (z - pz[joint]);
+        const float velocity_weight = present[0][joint] * (1.0f - fresh);
+
+        vx[joint] = velocity_weight * fvx + (1.0f - velocity_weight) * vx[joint] * (1.0f - fresh);
+        vy[joint] = velocity_weight * fvy + (1.0f - velocity_weight) * vy[joint] * (1.0f - fresh);
+        vz[joint] = velocity_weight * fvz + (1.0f - velocity_weight) * vz[joint] * (1.0f - fresh);
+        px[joint] = fx;
+        py[joint] = fy;
+        pz[joint] = fz;
+        seen[joint] = std::max(seen[joint], present[0][joint]);
+        position[0][joint] = fx;
+        position[1][joint] = fy;
+        position[2][joint] = fz;
+    }
+
+    // Orientations: slerp from the filtered towards the new quaternion, by a weight from the same
+    // cutoff rule driven by the filtered angular speed
+    float* qw = state.orientation[0];
+    float* qx = state.orientation[1];
+    float* qy = state.orientation[2];
+    float* qz = state.orientation[3];
+    float* angular_speed = state.angular_speed;
+    seen = state.orientation_seen;
+    const float rotation_min_cutoff_hz = m_config.rotation_min_cutoff_hz;
+    const float rotation_beta = m_config.rotation_beta;
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        const float fresh = 1.0f - seen[joint];
+        const float w = orientation[0][joint], x = orientation[1][joint], y = orientation[2][joint], z = orientation[3][joint];
+
+        const float dot = qw[joint] * w + qx[joint] * x + qy[joint] * y + qz[joint] * z;
+        // q and -q are the same rotation; take the short way round
+        const float sign = copysignf(1.0f, dot);
+        const float half_angle = AcosUnit(fabsf(dot));
+        const float speed = angular_speed[joint] + derivative_alpha * (2.0f * half_angle * inverse_dt - angular_speed[joint]);
+        const float alpha = SmoothingAlpha(dt, rotation_min_cutoff_hz + rotation_beta * speed);
+
+        // Slerp weights sin((1 - alpha) angle) / sin(angle) and sin(alpha angle) / sin(angle), written
+        // with sin(x) / x so they stay exact down to a zero angle without a branch
+        const float inverse_sinc = 1.0f / SincQuarterTurn(half_angle);
+        const float keep_weight = (1.0f - alpha) * SincQuarterTurn((1.0f - alpha) * half_angle) * inverse_sinc;
+        const float new_weight = sign * alpha * SincQuarterTurn(alpha * half_angle) * inverse_sinc;
+        const float bw = keep_weight * qw[joint] + new_weight * w;
+        const float bx = keep_weight * qx[joint] + new_weight * x;
+        const float by = keep_weight * qy[joint] + new_weight * y;
+        const float bz = keep_weight * qz[joint] + new_weight * z;
+        const float inverse_norm = 1.0f / sqrtf(bw * bw + bx * bx + by * by + bz * bz + 1e-12f);
+        // A fresh joint starts at its raw orientation and at rest
+        const float fw = bw * inverse_norm + fresh * (w - bw * inverse_norm);
+        const float fx = bx * inverse_norm + fresh * (x - bx * inverse_norm);
+        const float fy = by * inverse_norm + fresh * (y - by * inverse_norm);
+        const float fz = bz * inverse_norm + fresh * (z - bz * inverse_norm);
+        const float speed_weight = present[1][joint] * (1.0f - fresh);
+
+        angular_speed[joint] = speed_weight * speed + (1.0f - speed_weight) * angular_speed[joint] * (1.0f - fresh);
+        qw[joint] = fw;
+        qx[joint] = fx;
+        qy[joint] = fy;
+        qz[joint] = fz;
+        seen[joint] = std::max(seen[joint], present[1][joint]);
+        orientation[0][joint] = fw;
+        orientation[1][joint] = fx;
+        orientation[2][joint] = fy;
+        orientation[3][joint] = fz;
+    }
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        float* channels = out + joint * g_channelsPerJoint;
+        const bool position_present = present[0][joint] > 0.0f;
+        const bool orientation_present = present[1][joint] > 0.0f;
+        channels[0] = position_present ? position[0][joint] : nan;
+        channels[1] = position_present ? position[1][joint] : nan;
+        channels[2] = position_present ? position[2][joint] : nan;
+        channels[3] = orientation_present ? orientation[0][joint] : nan;
+        channels[4] = orientation_present ? orientation[1][joint] : nan;
+        channels[5] = orientation_present ? orientation[2][joint] : nan;
+        channels[6] = orientation_present ? orientation[3][joint] : nan;
+    }
+}
+
+void AppendSmoothingMetadata(lsl_streaminfo info, bool smoothed, const SmoothingConfig& config, float sdk_smoothing)
+{
+    lsl_xml_ptr smoothing = lsl_append_child(lsl_get_desc(info), "smoothing");
+    lsl_append_child_value(smoothing, "filter", smoothed ? "one-euro" : "none");
+    if (smoothed)
+    {
+        lsl_append_child_value(smoothing, "position_min_cutoff_hz", std::to_string(config.position_min_cutoff_hz).c_str());
+        lsl_append_child_value(smoothing, "position_beta", std::to_string(config.position_beta).c_str());
+        lsl_append_child_value(smoothing, "rotation_min_cutoff_hz", std::to_string(config.rotation_min_cutoff_hz).c_str());
+        lsl_append_child_value(smoothing, "rotation_beta", std::to_string(config.rotation_beta).c_str());
+        lsl_append_child_value(smoothing, "derivative_cutoff_hz", std::to_string(config.derivative_cutoff_hz).c_str());
+    }
+    lsl_append_child_value(smoothing, "sdk_temporal_smoothing", std::to_string(sdk_smoothing).c_str());
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <lsl_cpp.h>
+#include <k4abttypes.h>
+#include "BodySlots.h"
+#include "SpscRing.h"
+
+// Frames further apart than this (a body lost and found again) restart the filters
+#define SMOOTHING_MAX_GAP_USEC 250000
+
+// Outlets that can publish smoothed instead of raw joints, one bit each in PipelineConfig::smoothed_outlets
+typedef enum
+{
+    SMOOTHED_OUTLET_SKELETON = 0, // Azure-Kinect and its confidence
+    SMOOTHED_OUTLET_BODIES,       // Azure-Kinect-Body<slot>
+    SMOOTHED_OUTLET_KINEMATICS,   // Azure-Kinect-Kinematics
+    SMOOTHED_OUTLET_GEOMETRY,     // Azure-Kinect-Angles and Azure-Kinect-Bones
+    SMOOTHED_OUTLET_CONSTRAINED,  // Azure-Kinect-Constrained
+    SMOOTHED_OUTLET_COUNT
+} smoothed_outlet_t;
+
+const char* GetSmoothedOutletName(smoothed_outlet_t outlet);
+
+/**
+ * One Euro filter parameters. The cutoff frequency of each joint rises from the minimum cutoff
+ * with its speed times beta, so a joint at rest is smoothed hard while a moving joint follows with
+ * little lag. Speeds are filtered themselves with derivative_cutoff_hz.
+ */
+struct SmoothingConfig
+{
+    float position_min_cutoff_hz = 1.0f;
+    float position_beta = 0.01f;     // Hz of cutoff per mm/s
+    float rotation_min_cutoff_hz = 1.0f;
+    float rotation_beta = 0.5f;      // Hz of cutoff per rad/s
+    float derivative_cutoff_hz = 1.0f;
+};
+
+/**
+ * Low-latency smoothing of packed skeletons: a One Euro filter on every joint position, and an
+ * adaptive slerp on every orientation whose weight comes from the same cutoff rule driven by the
+ * joint's angular speed.
+ * Each body slot keeps its filter state as structure-of-arrays, one 32-float row per quantity, so
+ * all joints of a body go through one straight loop that the compiler turns into SIMD.
+ * Time steps come from device timestamps, so dropped frames do not change the filter's response.
+ */
+class JointSmoother
+{
+public:
+    JointSmoother(int body_slots, const SmoothingConfig& config);
+
+    // Filters the packed skeleton (layout documented next to g_jointNames) of the body in the slot
+    // into out, in the same layout. A new body, or one back after SMOOTHING_MAX_GAP_USEC, starts
+    // from its raw pose. NaN joints stay NaN and leave the joint's state untouched.
+    void Apply(int slot, uint32_t body_id, const float* joints, uint64_t device_usec, float* out);
+
+    // Forgets the slot's state and writes NaN, for slots without a body
+    void Clear(int slot, float* out);
+
+private:
+    struct alignas(CACHE_LINE_SIZE) SlotState
+    {
+        float position[3][K4ABT_JOINT_COUNT];    // Filtered position
+        float velocity[3][K4ABT_JOINT_COUNT];    // Filtered velocity in mm/s
+        float orientation[4][K4ABT_JOINT_COUNT]; // Filtered quaternion w, x, y, z
+        float angular_speed[K4ABT_JOINT_COUNT];  // Filtered angular speed in rad/s
+        float position_seen[K4ABT_JOINT_COUNT];  // 1 once the joint's position has been filtered, 0 before
+        float orientation_seen[K4ABT_JOINT_COUNT];
+        uint64_t device_usec;
+        uint32_t body_id;
+    };
+
+    void Reset(SlotState& state);
+
+    SmoothingConfig m_config;
+    std::vector<SlotState> m_slots;
+};
+
+// Records in a skeleton stream's description whether it carries smoothed joints, with the filter
+// parameters, and the tracker's own temporal smoothing factor
+void AppendSmoothingMetadata(lsl_streaminfo info, bool smoothed, const SmoothingConfig& config, float sdk_smoothing);
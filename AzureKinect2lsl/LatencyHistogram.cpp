@@ -0,0 +1,87 @@
+#include "LatencyHistogram.h"
+
+static int BucketIndex(uint64_t value_us)
+{
+    if (value_us < 2 * LATENCY_SUB_BUCKETS)
+    {
+        return (int)value_us;
+    }
+
+    // Shift value_us down until it falls in [LATENCY_SUB_BUCKETS, 2 * LATENCY_SUB_BUCKETS)
+    int shift = 0;
+    while ((value_us >> shift) >= 2 * LATENCY_SUB_BUCKETS)
+    {
+        shift++;
+    }
+    if (shift > LATENCY_MAX_SHIFT)
+    {
+        return LATENCY_BUCKET_COUNT - 1;
+    }
+    return shift * LATENCY_SUB_BUCKETS + (int)(value_us >> shift);
+}
+
+// Largest value that lands in the bucket
+static uint64_t BucketUpperEdgeUs(int index)
+{
+    if (index < 2 * LATENCY_SUB_BUCKETS)
+    {
+        return (uint64_t)index;
+    }
+    int shift = (index - LATENCY_SUB_BUCKETS) / LATENCY_SUB_BUCKETS;
+    uint64_t top_bits = (uint64_t)(index - shift * LATENCY_SUB_BUCKETS);
+    return ((top_bits + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(double seconds)
+{
+    uint64_t value_us = seconds > 0 ? (uint64_t)(seconds * 1e6) : 0;
+    m_counts[BucketIndex(value_us)].fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(value_us, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Snapshot(LatencySnapshot* snapshot) const
+{
+    snapshot->count = 0;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        snapshot->counts[i] = m_counts[i].load(std::memory_order_relaxed);
+        snapshot->count += snapshot->counts[i];
+    }
+    snapshot->sum_us = m_sumUs.load(std::memory_order_relaxed);
+}
+
+void LatencySnapshot::Subtract(const LatencySnapshot& older)
+{
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        counts[i] -= older.counts[i];
+    }
+    count -= older.count;
+    sum_us -= older.sum_us;
+}
+
+double LatencySnapshot::MeanMs() const
+{
+    return count > 0 ? (double)sum_us / count * 1e-3 : 0.0;
+}
+
+double LatencySnapshot::PercentileMs(double percentile) const
+{
+    if (count == 0)
+    {
+        return 0.0;
+    }
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+    rank = rank < 1 ? 1 : rank > count ? count : rank;
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            return BucketUpperEdgeUs(i) * 1e-3;
+        }
+    }
+    return BucketUpperEdgeUs(LATENCY_BUCKET_COUNT - 1) * 1e-3;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Log-linear bucketing in the style of HdrHistogram: values below 2 * LATENCY_SUB_BUCKETS microseconds
+// get a bucket each, above that every power of two is split into LATENCY_SUB_BUCKETS linear buckets,
+// so every recorded value is resolved to within 1/16 (about 6%).
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_SHIFT 36 // Values up to 2^40 us (about 12 days) are resolved; larger ones are clamped
+#define LATENCY_BUCKET_COUNT (2 * LATENCY_SUB_BUCKETS + LATENCY_MAX_SHIFT * LATENCY_SUB_BUCKETS)
+
+// Plain copy of a histogram, used for reporting. Subtracting an older snapshot gives the interval in between.
+struct LatencySnapshot
+{
+    uint64_t counts[LATENCY_BUCKET_COUNT] = {};
+    uint64_t count = 0;
+    uint64_t sum_us = 0;
+
+    void Subtract(const LatencySnapshot& older);
+    double MeanMs() const;
+    // Upper edge of the bucket holding the given percentile (0-100), in milliseconds
+    double PercentileMs(double percentile) const;
+};
+
+/**
+ * Latency histogram that any number of threads can record into without locks: recording is one
+ * relaxed atomic increment per bucket plus one for the running sum.
+ */
+class LatencyHistogram
+{
+public:
+    void Record(double seconds);
+    void Snapshot(LatencySnapshot* snapshot) const;
+
+private:
+    std::atomic<uint64_t> m_counts[LATENCY_BUCKET_COUNT] = {};
+    std::atomic<uint64_t> m_sumUs{ 0 };
+};
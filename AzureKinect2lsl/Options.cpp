@@ -0,0 +1,532 @@
+#include "Options.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void PrintUsage(const char* program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --device <n>             Stream only the device at this index (default: every attached device)\n");
+    printf("  --playback <file.mkv>    Track this recording as fast as possible instead of the attached devices\n");
+    printf("  --output <path>          With --playback, write the skeletons to this CSV file instead of LSL;\n");
+    printf("                           with --batch, the directory for the CSV files (default: next to each recording)\n");
+    printf("  --batch <dir|list>       Re-track every .mkv in a directory, or every file in a list, to CSV files\n");
+    printf("  --workers <n>            Recordings of a batch tracked at once, each on its own CPU tracker (default 1)\n");
+    printf("  --ramp <s>               Seconds between starting one batch worker and the next, 0 starts all at once (default %d)\n",
+        BATCH_DEFAULT_RAMP_S);
+    printf("  --sync <mode>            Wired sync: off (default), auto (from the connected jacks), master or subordinate\n");
+    printf("  --sync-delay <us>        Subordinate delay off the master per device index (default %d)\n", SYNC_SUBORDINATE_SPACING_USEC);
+    printf("  --depth-delay <us>       Depth capture delay off the color capture, -%d to %d (default 0)\n",
+        SYNC_MAX_DEPTH_DELAY_USEC, SYNC_MAX_DEPTH_DELAY_USEC);
+    printf("  --frame-sets             Match the frames of all devices into timestamp-aligned sets\n");
+    printf("  --frame-set-tolerance <us> Frames this close belong to one set (default %d with sync, %d without)\n",
+        FRAME_SET_SYNC_TOLERANCE_USEC, FRAME_SET_FREE_TOLERANCE_USEC);
+    printf("  --fuse                   Fuse the frame sets into one Azure-Kinect-Fused stream in a shared world frame\n");
+    printf("  --extrinsics <file>      Camera-to-world transform of every device for --fuse (default: all identity)\n");
+    printf("  --frames <n>             Stop after n captures (default: run until Ctrl+C)\n");
+    printf("  --duration <s>           Stop after s seconds (default: run until Ctrl+C)\n");
+    printf("  --bodies <n>             Body slots per sample, 1 to %d (default 1)\n", MAX_BODY_SLOTS);
+    printf("  --body-outlets           Also publish every body slot on its own LSL stream\n");
+    printf("  --primary <mode>         Publish only one body, chosen by: closest, volume, longest or confidence\n");
+    printf("  --primary-volume <box>   Volume for --primary volume as xmin,ymin,zmin,xmax,ymax,zmax in mm\n");
+    printf("                           (default -1000,-1500,500,1000,1500,3500)\n");
+    printf("  --overload <policy>      What to do when the tracker falls behind the camera:\n");
+    printf("                           block (default), drop-oldest, drop-newest, keep-latest\n");
+    printf("  --capture-queue <n>      Captures held back for the tracker before the policy applies (default 2)\n");
+    printf("  --publish-ring <n>       Packed skeletons buffered for the LSL publisher (default 64)\n");
+    printf("  --channel-format <fmt>   Sample format on the wire: float32 (default) or double64\n");
+    printf("  --chunk-frames <n>       Publish frames in chunks of n, each frame keeping its own timestamp (default 1)\n");
+    printf("  --chunk-ms <ms>          Publish a chunk once its oldest frame is this old (default off)\n");
+    printf("  --outlet-chunk <n>       Samples per LSL transmission chunk (default 0, chosen by LSL)\n");
+    printf("  --max-buffered <s>       Seconds of data the outlet buffers for slow consumers (default 60)\n");
+    printf("  --timestamps <source>    Clock the sample timestamps come from: device (default), system or pop\n");
+    printf("  --stats-interval <s>     Print per-stage latency histograms this often, 0 disables (default 10)\n");
+    printf("  --metrics-stream         Also publish the latency summary on an LSL metrics stream\n");
+    printf("  --body-index             Also publish the run-length encoded body index map\n");
+    printf("  --point-cloud <mm>       Also publish per-body point clouds downsampled to voxels of this size\n");
+    printf("  --confidence-stream      Also publish joint confidence levels on a uint8 side stream\n");
+    printf("  --min-confidence <level> Publish NaN positions for joints below this level: none (default), low, medium, high\n");
+    printf("  --kinematics-stream      Also publish joint velocities and accelerations\n");
+    printf("  --angle-stream           Also publish anatomical joint angles\n");
+    printf("  --bone-stream            Also publish bone directions\n");
+    printf("  --constrained-stream     Also publish skeletons with bone lengths estimated online\n");
+    printf("  --smooth <outlets>       Feed these outlets One Euro smoothed joints, comma separated or all:\n");
+    printf("                           skeleton, bodies, kinematics, geometry, constrained (default none)\n");
+    printf("  --smooth-position <c,b>  Position filter minimum cutoff in Hz and beta per mm/s (default 1,0.01)\n");
+    printf("  --smooth-rotation <c,b>  Orientation filter minimum cutoff in Hz and beta per rad/s (default 1,0.5)\n");
+    printf("  --sdk-smoothing <f>      The tracker's own temporal smoothing factor, 0 to 1 (default 0)\n");
+    printf("  --benchmark <name>       Run a microbenchmark on synthetic data and exit: pack, select, rle, cloud, smooth,\n");
+    printf("                           constrained, frameset, fuse\n");
+}
+
+static bool ParseInt(const char* value, int minimum, int* result)
+{
+    char* end = NULL;
+    long parsed = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || parsed < minimum || parsed > INT_MAX)
+    {
+        return false;
+    }
+    *result = (int)parsed;
+    return true;
+}
+
+static bool ParseCount(const char* value, size_t* count)
+{
+    int parsed = 0;
+    if (!ParseInt(value, 1, &parsed))
+    {
+        return false;
+    }
+    *count = (size_t)parsed;
+    return true;
+}
+
+static bool ParseOverloadPolicy(const char* value, overload_policy_t* policy)
+{
+    for (int i = 0; i < OVERLOAD_POLICY_COUNT; i++)
+    {
+        if (strcmp(value, GetOverloadPolicyName((overload_policy_t)i)) == 0)
+        {
+            *policy = (overload_policy_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParsePrimarySelection(const char* value, primary_selection_t* selection)
+{
+    for (int i = 0; i < PRIMARY_SELECTION_COUNT; i++)
+    {
+        if (strcmp(value, GetPrimarySelectionName((primary_selection_t)i)) == 0)
+        {
+            *selection = (primary_selection_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Exactly count comma-separated floats and nothing after the last one
+static bool ParseFloatList(const char* value, float* values, int count)
+{
+    const char* next = value;
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            if (*next != ',')
+            {
+                return false;
+            }
+            next++;
+        }
+        char* end = NULL;
+        values[i] = strtof(next, &end);
+        if (end == next)
+        {
+            return false;
+        }
+        next = end;
+    }
+    return *next == '\0';
+}
+
+static bool ParseSelectionVolume(const char* value, SelectionVolume* volume)
+{
+    float values[6];
+    if (!ParseFloatList(value, values, 6))
+    {
+        return false;
+    }
+    SelectionVolume parsed;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        parsed.min[axis] = values[axis];
+        parsed.max[axis] = values[3 + axis];
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (parsed.min[axis] >= parsed.max[axis])
+        {
+            return false;
+        }
+    }
+    *volume = parsed;
+    return true;
+}
+
+static bool ParseConfidenceLevel(const char* value, k4abt_joint_confidence_level_t* level)
+{
+    for (int i = 0; i < K4ABT_JOINT_CONFIDENCE_LEVELS_COUNT; i++)
+    {
+        if (strcmp(value, GetConfidenceLevelName((k4abt_joint_confidence_level_t)i)) == 0)
+        {
+            *level = (k4abt_joint_confidence_level_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseSmoothedOutlets(const char* value, uint32_t* outlets)
+{
+    if (strcmp(value, "all") == 0)
+    {
+        *outlets = (1u << SMOOTHED_OUTLET_COUNT) - 1;
+        return true;
+    }
+    uint32_t parsed = 0;
+    const char* name = value;
+    while (true)
+    {
+        const char* end = strchr(name, ',');
+        size_t length = end != NULL ? (size_t)(end - name) : strlen(name);
+        bool known = false;
+        for (int i = 0; i < SMOOTHED_OUTLET_COUNT; i++)
+        {
+            const char* candidate = GetSmoothedOutletName((smoothed_outlet_t)i);
+            if (strlen(candidate) == length && strncmp(name, candidate, length) == 0)
+            {
+                parsed |= 1u << i;
+                known = true;
+            }
+        }
+        if (!known)
+        {
+            return false;
+        }
+        if (end == NULL)
+        {
+            break;
+        }
+        name = end + 1;
+    }
+    *outlets = parsed;
+    return true;
+}
+
+// A minimum cutoff in Hz and a beta, as "cutoff,beta"
+static bool ParseSmoothingParameters(const char* value, float* min_cutoff_hz, float* beta)
+{
+    float values[2];
+    if (!ParseFloatList(value, values, 2) || !(values[0] > 0.0f) || !(values[1] >= 0.0f))
+    {
+        return false;
+    }
+    *min_cutoff_hz = values[0];
+    *beta = values[1];
+    return true;
+}
+
+static bool ParseChannelFormat(const char* value, lsl_channel_format_t* channel_format)
+{
+    const lsl_channel_format_t supported[] = { cft_float32, cft_double64 };
+    for (lsl_channel_format_t candidate : supported)
+    {
+        if (strcmp(value, GetChannelFormatName(candidate)) == 0)
+        {
+            *channel_format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseTimestampSource(const char* value, timestamp_source_t* source)
+{
+    for (int i = 0; i < TIMESTAMP_SOURCE_COUNT; i++)
+    {
+        if (strcmp(value, GetTimestampSourceName((timestamp_source_t)i)) == 0)
+        {
+            *source = (timestamp_source_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseSyncMode(const char* value, sync_mode_t* mode)
+{
+    for (int i = 0; i < SYNC_MODE_COUNT; i++)
+    {
+        if (strcmp(value, GetSyncModeName((sync_mode_t)i)) == 0)
+        {
+            *mode = (sync_mode_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParseOptions(int argc, char** argv, StreamerOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = false;
+
+        if (strcmp(arg, "--device") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 0, &options.device_index);
+            i++;
+        }
+        else if (strcmp(arg, "--playback") == 0 && value != NULL)
+        {
+            options.playback = value;
+            ok = true;
+            i++;
+        }
+        else if (strcmp(arg, "--output") == 0 && value != NULL)
+        {
+            options.output = value;
+            ok = true;
+            i++;
+        }
+        else if (strcmp(arg, "--batch") == 0 && value != NULL)
+        {
+            options.batch = value;
+            ok = true;
+            i++;
+        }
+        else if (strcmp(arg, "--workers") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 1, &options.batch_workers);
+            i++;
+        }
+        else if (strcmp(arg, "--ramp") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 0, &options.batch_ramp_s);
+            i++;
+        }
+        else if (strcmp(arg, "--sync") == 0 && value != NULL)
+        {
+            ok = ParseSyncMode(value, &options.sync.mode);
+            i++;
+        }
+        else if (strcmp(arg, "--sync-delay") == 0 && value != NULL)
+        {
+            int delay = 0;
+            ok = ParseInt(value, 0, &delay);
+            options.sync.subordinate_delay_usec = (uint32_t)delay;
+            i++;
+        }
+        else if (strcmp(arg, "--depth-delay") == 0 && value != NULL)
+        {
+            int delay = 0;
+            ok = ParseInt(value, -SYNC_MAX_DEPTH_DELAY_USEC, &delay) && delay <= SYNC_MAX_DEPTH_DELAY_USEC;
+            options.sync.depth_delay_off_color_usec = delay;
+            i++;
+        }
+        else if (strcmp(arg, "--frame-sets") == 0)
+        {
+            options.frame_sets = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--frame-set-tolerance") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 1, &options.frame_set_tolerance_usec);
+            i++;
+        }
+        else if (strcmp(arg, "--fuse") == 0)
+        {
+            options.fuse = true;
+            options.frame_sets = true;
+            options.frame_set.min_devices = 1; // A single view still beats a dropout
+            ok = true;
+        }
+        else if (strcmp(arg, "--extrinsics") == 0 && value != NULL)
+        {
+            options.extrinsics = value;
+            ok = true;
+            i++;
+        }
+        else if (strcmp(arg, "--frames") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 1, &options.pipeline.max_captures);
+            i++;
+        }
+        else if (strcmp(arg, "--duration") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 1, &options.pipeline.max_duration_s);
+            i++;
+        }
+        else if (strcmp(arg, "--bodies") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 1, &options.pipeline.body_slots) && options.pipeline.body_slots <= MAX_BODY_SLOTS;
+            i++;
+        }
+        else if (strcmp(arg, "--body-outlets") == 0)
+        {
+            options.stream.body_outlets = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--primary") == 0 && value != NULL)
+        {
+            ok = ParsePrimarySelection(value, &options.pipeline.primary_selection);
+            i++;
+        }
+        else if (strcmp(arg, "--primary-volume") == 0 && value != NULL)
+        {
+            ok = ParseSelectionVolume(value, &options.pipeline.selection_volume);
+            i++;
+        }
+        else if (strcmp(arg, "--overload") == 0 && value != NULL)
+        {
+            ok = ParseOverloadPolicy(value, &options.pipeline.overload_policy);
+            i++;
+        }
+        else if (strcmp(arg, "--capture-queue") == 0 && value != NULL)
+        {
+            ok = ParseCount(value, &options.pipeline.capture_queue_depth);
+            i++;
+        }
+        else if (strcmp(arg, "--publish-ring") == 0 && value != NULL)
+        {
+            ok = ParseCount(value, &options.pipeline.publish_ring_capacity);
+            i++;
+        }
+        else if (strcmp(arg, "--channel-format") == 0 && value != NULL)
+        {
+            ok = ParseChannelFormat(value, &options.stream.channel_format);
+            i++;
+        }
+        else if (strcmp(arg, "--chunk-frames") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 1, &options.pipeline.chunk_frames);
+            i++;
+        }
+        else if (strcmp(arg, "--chunk-ms") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 0, &options.pipeline.chunk_ms);
+            i++;
+        }
+        else if (strcmp(arg, "--outlet-chunk") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 0, &options.stream.outlet_chunk_size);
+            i++;
+        }
+        else if (strcmp(arg, "--max-buffered") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 1, &options.stream.max_buffered);
+            i++;
+        }
+        else if (strcmp(arg, "--timestamps") == 0 && value != NULL)
+        {
+            ok = ParseTimestampSource(value, &options.pipeline.timestamp_source);
+            i++;
+        }
+        else if (strcmp(arg, "--stats-interval") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 0, &options.pipeline.stats_interval_s);
+            i++;
+        }
+        else if (strcmp(arg, "--metrics-stream") == 0)
+        {
+            options.pipeline.metrics_stream = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--body-index") == 0)
+        {
+            options.pipeline.body_index_stream = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--point-cloud") == 0 && value != NULL)
+        {
+            ok = ParseInt(value, 1, &options.pipeline.point_cloud_voxel_mm);
+            i++;
+        }
+        else if (strcmp(arg, "--confidence-stream") == 0)
+        {
+            options.pipeline.confidence_stream = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--min-confidence") == 0 && value != NULL)
+        {
+            ok = ParseConfidenceLevel(value, &options.pipeline.min_confidence);
+            i++;
+        }
+        else if (strcmp(arg, "--kinematics-stream") == 0)
+        {
+            options.pipeline.kinematics_stream = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--angle-stream") == 0)
+        {
+            options.pipeline.angle_stream = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--bone-stream") == 0)
+        {
+            options.pipeline.bone_stream = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--constrained-stream") == 0)
+        {
+            options.pipeline.constrained_stream = true;
+            ok = true;
+        }
+        else if (strcmp(arg, "--smooth") == 0 && value != NULL)
+        {
+            ok = ParseSmoothedOutlets(value, &options.pipeline.smoothed_outlets);
+            i++;
+        }
+        else if (strcmp(arg, "--smooth-position") == 0 && value != NULL)
+        {
+            ok = ParseSmoothingParameters(value, &options.pipeline.smoothing.position_min_cutoff_hz, &options.pipeline.smoothing.position_beta);
+            i++;
+        }
+        else if (strcmp(arg, "--smooth-rotation") == 0 && value != NULL)
+        {
+            ok = ParseSmoothingParameters(value, &options.pipeline.smoothing.rotation_min_cutoff_hz, &options.pipeline.smoothing.rotation_beta);
+            i++;
+        }
+        else if (strcmp(arg, "--sdk-smoothing") == 0 && value != NULL)
+        {
+            char* end = NULL;
+            options.sdk_smoothing = strtof(value, &end);
+            ok = end != value && *end == '\0' && options.sdk_smoothing >= 0.0f && options.sdk_smoothing <= 1.0f;
+            i++;
+        }
+        else if (strcmp(arg, "--benchmark") == 0 && value != NULL)
+        {
+            options.benchmark = value;
+            ok = true;
+            i++;
+        }
+
+        if (!ok)
+        {
+            printf("Invalid argument: %s\n", arg);
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if (options.pipeline.primary_selection != PRIMARY_SELECTION_OFF && options.pipeline.body_slots > 1)
+    {
+        printf("--primary publishes a single body and cannot be combined with --bodies\n");
+        return false;
+    }
+    if (options.output != NULL && options.playback == NULL && options.batch == NULL)
+    {
+        printf("--output writes the skeletons of a --playback recording or a --batch\n");
+        return false;
+    }
+    if (options.playback != NULL && options.batch != NULL)
+    {
+        printf("--playback and --batch cannot be combined\n");
+        return false;
+    }
+    if ((options.playback != NULL || options.batch != NULL) && options.pipeline.timestamp_source == TIMESTAMP_SOURCE_SYSTEM)
+    {
+        // Recorded images carry no system timestamp, so every frame would be stamped 0
+        printf("Recordings have no system timestamps; use --timestamps device or pop with --playback and --batch\n");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "BatchTracker.h"
+#include "DeviceSync.h"
+#include "FrameSetAssembler.h"
+#include "SkeletonPipeline.h"
+#include "SkeletonStream.h"
+
+// Everything that can be set on the command line.
+struct StreamerOptions
+{
+    PipelineConfig pipeline;
+    StreamConfig stream;
+    int device_index = -1;        // Stream only the device at this index; -1 streams every attached device
+    const char* playback = NULL;  // Track this recording instead of the attached devices
+    const char* output = NULL;    // Write the recording's skeletons to this CSV file instead of LSL; the directory for a batch
+    const char* batch = NULL;     // Re-track the recordings in this directory or list file
+    int batch_workers = 1;        // Recordings tracked at once, each on a CPU tracker of its own
+    int batch_ramp_s = BATCH_DEFAULT_RAMP_S; // Seconds between starting one batch worker and the next
+    SyncConfig sync;
+    bool frame_sets = false;      // Assemble the devices' frames into timestamp-aligned sets
+    FrameSetConfig frame_set;
+    int frame_set_tolerance_usec = 0; // 0 picks FRAME_SET_SYNC_TOLERANCE_USEC or FRAME_SET_FREE_TOLERANCE_USEC
+    bool fuse = false;            // Fuse every frame set into one skeleton stream; implies frame_sets
+    const char* extrinsics = NULL; // File with every device's camera-to-world transform, for fusion
+    float sdk_smoothing = 0.0f;   // k4abt_tracker_set_temporal_smoothing factor; 0, the SDK default, disables it
+    const char* benchmark = NULL; // Run this microbenchmark instead of streaming
+};
+
+// Parses argv into options, leaving defaults for anything not given.
+// Prints the usage and returns false if an argument is unknown or malformed.
+bool ParseOptions(int argc, char** argv, StreamerOptions& options);
@@ -0,0 +1,80 @@
+#include "PipelineMetrics.h"
+
+#include <stdio.h>
+#include <string>
+
+const char* GetPipelineStageName(pipeline_stage_t stage)
+{
+    switch (stage)
+    {
+    case PIPELINE_STAGE_BACKLOG:    return "backlog";
+    case PIPELINE_STAGE_TRACKER:    return "tracker";
+    case PIPELINE_STAGE_PUBLISH:    return "publish";
+    case PIPELINE_STAGE_END_TO_END: return "end_to_end";
+    default:                        return "unknown";
+    }
+}
+
+void PrintPipelineMetrics(const char* source_id, const LatencySnapshot* stages, const PipelineCounts& counts, double interval_seconds)
+{
+    printf("%s, last %.0f s: %.1f fps published, %llu captures dropped, %llu ring overruns\n", source_id, interval_seconds,
+        counts.published / interval_seconds, (unsigned long long)counts.dropped_captures, (unsigned long long)counts.ring_overruns);
+    for (int stage = 0; stage < PIPELINE_STAGE_COUNT; stage++)
+    {
+        const LatencySnapshot& latency = stages[stage];
+        printf("  %-10s n=%-6llu mean %7.2f  p50 %7.2f  p99 %7.2f  max %7.2f ms\n", GetPipelineStageName((pipeline_stage_t)stage),
+            (unsigned long long)latency.count, latency.MeanMs(), latency.PercentileMs(50), latency.PercentileMs(99),
+            latency.PercentileMs(100));
+    }
+}
+
+lsl_streaminfo CreateMetricsStreamInfo(const std::string& source_id, double interval_seconds)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-Metrics", "Metrics", METRICS_CHANNEL_COUNT, 1.0 / interval_seconds,
+        cft_double64, (source_id + "-metrics").c_str());
+
+    lsl_xml_ptr desc = lsl_get_desc(info);
+    lsl_append_child_value(desc, "manufacturer", "University of Groningen");
+    lsl_append_child_value(desc, "model", "Azure Kinect");
+
+    const char* suffixes[METRICS_VALUES_PER_STAGE] = { "_mean", "_p50", "_p99", "_max" };
+    lsl_xml_ptr chns = lsl_append_child(desc, "channels");
+    for (int stage = 0; stage < PIPELINE_STAGE_COUNT; stage++)
+    {
+        for (const char* suffix : suffixes)
+        {
+            lsl_xml_ptr channel = lsl_append_child(chns, "channel");
+            lsl_append_child_value(channel, "name", (std::string(GetPipelineStageName((pipeline_stage_t)stage)) + suffix).c_str());
+            lsl_append_child_value(channel, "unit", "ms");
+        }
+    }
+
+    const char* counters[][2] = { { "published_rate", "Hz" }, { "dropped_captures", "count" }, { "ring_overruns", "count" }, { "clock_drift", "ppm" } };
+    for (const auto& counter : counters)
+    {
+        lsl_xml_ptr channel = lsl_append_child(chns, "channel");
+        lsl_append_child_value(channel, "name", counter[0]);
+        lsl_append_child_value(channel, "unit", counter[1]);
+    }
+
+    return info;
+}
+
+void FillMetricsSample(const LatencySnapshot* stages, const PipelineCounts& counts, double interval_seconds,
+    double drift_ppm, double* sample)
+{
+    for (int stage = 0; stage < PIPELINE_STAGE_COUNT; stage++)
+    {
+        double* out = sample + stage * METRICS_VALUES_PER_STAGE;
+        out[0] = stages[stage].MeanMs();
+        out[1] = stages[stage].PercentileMs(50);
+        out[2] = stages[stage].PercentileMs(99);
+        out[3] = stages[stage].PercentileMs(100);
+    }
+
+    double* out = sample + PIPELINE_STAGE_COUNT * METRICS_VALUES_PER_STAGE;
+    out[0] = counts.published / interval_seconds;
+    out[1] = (double)counts.dropped_captures;
+    out[2] = (double)counts.ring_overruns;
+    out[3] = drift_ppm;
+}
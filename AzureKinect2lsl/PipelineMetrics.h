@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <lsl_cpp.h>
+#include "LatencyHistogram.h"
+
+// Latency stages between a capture arriving on the host and its skeleton reaching LSL.
+typedef enum
+{
+    PIPELINE_STAGE_BACKLOG = 0, // Capture arrived -> accepted by k4abt_tracker_enqueue_capture
+    PIPELINE_STAGE_TRACKER,     // Accepted by the tracker -> body frame popped
+    PIPELINE_STAGE_PUBLISH,     // Body frame popped -> pushed to the outlet (ring wait, chunking, LSL)
+    PIPELINE_STAGE_END_TO_END,  // Sample timestamp (capture time on the LSL clock) -> pushed to the outlet
+    PIPELINE_STAGE_COUNT
+} pipeline_stage_t;
+
+const char* GetPipelineStageName(pipeline_stage_t stage);
+
+// Interval totals reported next to the latencies
+struct PipelineCounts
+{
+    uint64_t published;
+    uint64_t dropped_captures;
+    uint64_t ring_overruns;
+};
+
+// Prints one line per stage with the interval's latency distribution, headed by the device's source_id.
+void PrintPipelineMetrics(const char* source_id, const LatencySnapshot* stages, const PipelineCounts& counts, double interval_seconds);
+
+/**
+ * Low-rate metrics stream, one sample per reporting interval. Channels: mean, p50, p99 and max in ms
+ * for every stage in pipeline_stage_t order, then published frames per second, dropped captures,
+ * publish ring overruns and the clock model drift in ppm.
+ */
+#define METRICS_VALUES_PER_STAGE 4
+#define METRICS_CHANNEL_COUNT (PIPELINE_STAGE_COUNT * METRICS_VALUES_PER_STAGE + 4)
+
+lsl_streaminfo CreateMetricsStreamInfo(const std::string& source_id, double interval_seconds);
+void FillMetricsSample(const LatencySnapshot* stages, const PipelineCounts& counts, double interval_seconds,
+    double drift_ppm, double* sample);
@@ -0,0 +1,139 @@
+#include "PrimarySelector.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+// Score of a body that cannot be selected at all
+static const float NOT_ELIGIBLE = -std::numeric_limits<float>::infinity();
+
+const char* GetPrimarySelectionName(primary_selection_t selection)
+{
+    switch (selection)
+    {
+    case PRIMARY_SELECTION_OFF:        return "off";
+    case PRIMARY_SELECTION_CLOSEST:    return "closest";
+    case PRIMARY_SELECTION_VOLUME:     return "volume";
+    case PRIMARY_SELECTION_LONGEST:    return "longest";
+    case PRIMARY_SELECTION_CONFIDENCE: return "confidence";
+    default:                           return "unknown";
+    }
+}
+
+PrimarySelector::PrimarySelector(primary_selection_t selection, const SelectionVolume& volume)
+    : m_selection(selection), m_volume(volume)
+{
+    // How much better a challenger has to score, in the unit of the score
+    switch (selection)
+    {
+    case PRIMARY_SELECTION_CLOSEST:
+    case PRIMARY_SELECTION_VOLUME:     m_margin = 250.0f; break; // mm
+    case PRIMARY_SELECTION_CONFIDENCE: m_margin = 0.25f; break;  // Mean confidence level
+    default:                           m_margin = 0.0f; break;   // Frames
+    }
+}
+
+void PrimarySelector::UpdateAges(const uint32_t* body_ids, size_t num_bodies)
+{
+    uint32_t ages[MAX_FRAME_BODIES];
+    for (size_t i = 0; i < num_bodies; i++)
+    {
+        const uint32_t* known = std::find(m_ageIds, m_ageIds + m_ageCount, body_ids[i]);
+        ages[i] = known != m_ageIds + m_ageCount ? m_ages[known - m_ageIds] + 1 : 1;
+    }
+    std::copy(body_ids, body_ids + num_bodies, m_ageIds);
+    std::copy(ages, ages + num_bodies, m_ages);
+    m_ageCount = num_bodies;
+}
+
+float PrimarySelector::Score(const k4abt_skeleton_t& skeleton, uint32_t age) const
+{
+    const float* pelvis = skeleton.joints[K4ABT_JOINT_PELVIS].position.v;
+    switch (m_selection)
+    {
+    case PRIMARY_SELECTION_CLOSEST:
+        return -sqrtf(pelvis[0] * pelvis[0] + pelvis[1] * pelvis[1] + pelvis[2] * pelvis[2]);
+    case PRIMARY_SELECTION_VOLUME:
+    {
+        float distance_squared = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (pelvis[axis] < m_volume.min[axis] || pelvis[axis] > m_volume.max[axis])
+            {
+                return NOT_ELIGIBLE;
+            }
+            float d = pelvis[axis] - (m_volume.min[axis] + m_volume.max[axis]) * 0.5f;
+            distance_squared += d * d;
+        }
+        return -sqrtf(distance_squared);
+    }
+    case PRIMARY_SELECTION_LONGEST:
+        return (float)age;
+    case PRIMARY_SELECTION_CONFIDENCE:
+    {
+        int total = 0;
+        for (const k4abt_joint_t& joint : skeleton.joints)
+        {
+            total += joint.confidence_level;
+        }
+        return (float)total / K4ABT_JOINT_COUNT;
+    }
+    default:
+        return NOT_ELIGIBLE;
+    }
+}
+
+int PrimarySelector::Select(const uint32_t* body_ids, const k4abt_skeleton_t* skeletons, size_t num_bodies)
+{
+    num_bodies = std::min<size_t>(num_bodies, MAX_FRAME_BODIES);
+    UpdateAges(body_ids, num_bodies);
+
+    int best = -1;
+    int current = -1;
+    float best_score = NOT_ELIGIBLE;
+    float current_score = NOT_ELIGIBLE;
+    for (size_t i = 0; i < num_bodies; i++)
+    {
+        float score = Score(skeletons[i], m_ages[i]);
+        if (score > best_score)
+        {
+            best = (int)i;
+            best_score = score;
+        }
+        if (body_ids[i] == m_primaryId)
+        {
+            current = (int)i;
+            current_score = score;
+        }
+    }
+
+    // The primary body left or is no longer eligible: take the best one straight away
+    if (current < 0 || current_score == NOT_ELIGIBLE)
+    {
+        m_primaryId = best >= 0 ? body_ids[best] : K4ABT_INVALID_BODY_ID;
+        m_challengerId = K4ABT_INVALID_BODY_ID;
+        m_challengerFrames = 0;
+        return best;
+    }
+
+    // Otherwise a challenger has to win clearly and for long enough
+    if (best != current && best_score > current_score + m_margin)
+    {
+        m_challengerFrames = body_ids[best] == m_challengerId ? m_challengerFrames + 1 : 1;
+        m_challengerId = body_ids[best];
+        if (m_challengerFrames >= PRIMARY_SWITCH_FRAMES)
+        {
+            m_primaryId = body_ids[best];
+            m_challengerId = K4ABT_INVALID_BODY_ID;
+            m_challengerFrames = 0;
+            m_switches++;
+            return best;
+        }
+    }
+    else
+    {
+        m_challengerId = K4ABT_INVALID_BODY_ID;
+        m_challengerFrames = 0;
+    }
+    return current;
+}
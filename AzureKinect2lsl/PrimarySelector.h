@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <k4abttypes.h>
+#include "BodySlots.h"
+
+// Consecutive frames a challenger has to win before it takes over as the primary body
+#define PRIMARY_SWITCH_FRAMES 15
+
+// How the primary body is picked when several are in view.
+typedef enum
+{
+    PRIMARY_SELECTION_OFF = 0,     // No selection, bodies go into slots
+    PRIMARY_SELECTION_CLOSEST,     // Pelvis closest to the camera
+    PRIMARY_SELECTION_VOLUME,      // Pelvis inside the configured volume, closest to its centre
+    PRIMARY_SELECTION_LONGEST,     // Body id tracked for the most consecutive frames
+    PRIMARY_SELECTION_CONFIDENCE,  // Highest mean joint confidence
+    PRIMARY_SELECTION_COUNT
+} primary_selection_t;
+
+const char* GetPrimarySelectionName(primary_selection_t selection);
+
+// Axis-aligned box in depth camera coordinates, in mm (x right, y down, z away from the camera)
+struct SelectionVolume
+{
+    float min[3] = { -1000.0f, -1500.0f, 500.0f };
+    float max[3] = { 1000.0f, 1500.0f, 3500.0f };
+};
+
+/**
+ * Picks one body per frame with hysteresis: the current primary body stays selected while it is
+ * tracked (and, for the volume mode, inside the volume) unless another body beats its score by a
+ * mode-specific margin for PRIMARY_SWITCH_FRAMES frames in a row. A handful of arithmetic per
+ * body and no allocation, so it costs nothing next to the tracker.
+ */
+class PrimarySelector
+{
+public:
+    PrimarySelector(primary_selection_t selection, const SelectionVolume& volume);
+
+    bool IsEnabled() const { return m_selection != PRIMARY_SELECTION_OFF; }
+
+    // Returns the index of the primary body among this frame's bodies, or -1 if none qualifies.
+    int Select(const uint32_t* body_ids, const k4abt_skeleton_t* skeletons, size_t num_bodies);
+
+    // Times the primary body changed to another tracked body
+    uint64_t GetSwitches() const { return m_switches; }
+
+private:
+    void UpdateAges(const uint32_t* body_ids, size_t num_bodies);
+    float Score(const k4abt_skeleton_t& skeleton, uint32_t age) const;
+
+    primary_selection_t m_selection;
+    SelectionVolume m_volume;
+    float m_margin;
+
+    uint32_t m_primaryId = K4ABT_INVALID_BODY_ID;
+    uint32_t m_challengerId = K4ABT_INVALID_BODY_ID;
+    int m_challengerFrames = 0;
+    uint64_t m_switches = 0;
+
+    // Consecutive frames each body of the last frame has been tracked, in frame order
+    uint32_t m_ageIds[MAX_FRAME_BODIES];
+    uint32_t m_ages[MAX_FRAME_BODIES];
+    size_t m_ageCount = 0;
+};
@@ -0,0 +1,185 @@
+#include "RecordingStreamer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <lsl_cpp.h>
+#include <k4a/k4a.h>
+#include <k4abt.h>
+#include <k4arecord/playback.h>
+#include "BodyTrackingHelpers.h"
+#include "CaptureSource.h"
+#include "SkeletonFileWriter.h"
+#include "SkeletonPipeline.h"
+#include "SkeletonStream.h"
+#include "StopSignal.h"
+
+std::string GetRecordingSourceId(const char* path)
+{
+    const char* name = path;
+    for (const char* c = path; *c != '\0'; c++)
+    {
+        if (*c == '/' || *c == '\\')
+        {
+            name = c + 1;
+        }
+    }
+    const char* extension = strrchr(name, '.');
+    return extension != NULL && extension != name ? std::string(name, extension) : std::string(name);
+}
+
+static int GetFramesPerSecond(k4a_fps_t camera_fps)
+{
+    switch (camera_fps)
+    {
+    case K4A_FRAMES_PER_SECOND_5:  return 5;
+    case K4A_FRAMES_PER_SECOND_15: return 15;
+    default:                       return 30;
+    }
+}
+
+// Adds a <recording> node naming the file the stream was tracked from
+static void AppendRecordingMetadata(lsl_streaminfo info, const char* path, uint64_t length_usec, timestamp_source_t timestamp_source)
+{
+    char value[64];
+    lsl_xml_ptr recording = lsl_append_child(lsl_get_desc(info), "recording");
+    lsl_append_child_value(recording, "file", path);
+    snprintf(value, sizeof(value), "%.3f", length_usec * 1e-6);
+    lsl_append_child_value(recording, "length_s", value);
+    lsl_append_child_value(recording, "timestamp_source", GetTimestampSourceName(timestamp_source));
+    lsl_append_child_value(recording, "timestamps", timestamp_source == TIMESTAMP_SOURCE_POP ?
+        "lsl_local_clock() when the frame was tracked" : "the recording's own device timestamps in seconds");
+}
+
+int StreamRecording(const char* path, const char* output_path, const StreamerOptions& options,
+    bool cpu_tracker, RecordingProgress* progress)
+{
+    const std::string source_id = GetRecordingSourceId(path);
+    k4a_playback_t playback = NULL;
+    if (k4a_playback_open(path, &playback) != K4A_RESULT_SUCCEEDED)
+    {
+        printf("Cannot open recording %s\n", path);
+        return -1;
+    }
+
+    k4a_record_configuration_t record_config;
+    if (k4a_playback_get_record_configuration(playback, &record_config) != K4A_RESULT_SUCCEEDED || !record_config.depth_track_enabled)
+    {
+        printf("%s: the recording has no depth track\n", source_id.c_str());
+        k4a_playback_close(playback);
+        return -1;
+    }
+    k4a_calibration_t sensor_calibration;
+    if (k4a_playback_get_calibration(playback, &sensor_calibration) != K4A_RESULT_SUCCEEDED)
+    {
+        printf("%s: get calibration from the recording failed!\n", source_id.c_str());
+        k4a_playback_close(playback);
+        return -1;
+    }
+    const uint64_t length_usec = k4a_playback_get_recording_length_usec(playback);
+    if (progress != NULL)
+    {
+        progress->expected_frames = length_usec * GetFramesPerSecond(record_config.camera_fps) / 1000000;
+    }
+
+    const bool quiet = options.pipeline.quiet;
+    k4abt_tracker_t tracker = NULL;
+    k4abt_tracker_configuration_t tracker_config = K4ABT_TRACKER_CONFIG_DEFAULT;
+    tracker_config.processing_mode = cpu_tracker ? K4ABT_TRACKER_PROCESSING_MODE_CPU : K4ABT_TRACKER_PROCESSING_MODE_GPU_CUDA;
+    k4a_result_t create_result = k4abt_tracker_create(&sensor_calibration, tracker_config, &tracker);
+    if (create_result != K4A_RESULT_SUCCEEDED && !cpu_tracker)
+    {
+        printf("%s: CUDA body tracker initialization failed!\n", source_id.c_str());
+        tracker_config.processing_mode = K4ABT_TRACKER_PROCESSING_MODE_CPU;
+        create_result = k4abt_tracker_create(&sensor_calibration, tracker_config, &tracker);
+    }
+    if (create_result != K4A_RESULT_SUCCEEDED)
+    {
+        printf("%s: body tracker initialization failed!\n", source_id.c_str());
+        k4a_playback_close(playback);
+        return -1;
+    }
+    if (!quiet)
+    {
+        printf("%s: running tracker is %s\n", source_id.c_str(),
+            tracker_config.processing_mode == K4ABT_TRACKER_PROCESSING_MODE_CPU ? "standard (slow) mode" : "CUDA mode");
+    }
+    k4abt_tracker_set_temporal_smoothing(tracker, options.sdk_smoothing);
+
+    // Every frame of the recording is published, so the stream declares the camera's rate
+    PipelineConfig config = options.pipeline;
+    config.lossless = true;
+    lsl_outlet outlet = NULL;
+    SkeletonFileWriter writer(source_id, config.body_slots);
+    if (output_path != NULL)
+    {
+        if (!writer.Open(output_path))
+        {
+            k4abt_tracker_destroy(tracker);
+            k4a_playback_close(playback);
+            return -1;
+        }
+        if (progress != NULL)
+        {
+            writer.SetFrameCounter(&progress->frames);
+        }
+        if (!quiet)
+        {
+            printf("%s: writing %d channels to %s\n", source_id.c_str(), config.body_slots * g_skeletonChannelCount, output_path);
+        }
+    }
+    else
+    {
+        lsl_streaminfo info = CreateSkeletonStreamInfo(source_id, GetFramesPerSecond(record_config.camera_fps), config.body_slots, options.stream);
+        AppendSmoothingMetadata(info, (config.smoothed_outlets & (1u << SMOOTHED_OUTLET_SKELETON)) != 0, config.smoothing, options.sdk_smoothing);
+        AppendRecordingMetadata(info, path, length_usec, config.timestamp_source);
+        outlet = CreateSkeletonOutlet(info, options.stream);
+        printf("%s: streaming %d %s channels\n", source_id.c_str(), config.body_slots * g_skeletonChannelCount,
+            GetChannelFormatName(options.stream.channel_format));
+        printf("%s: waiting for recorder\n", source_id.c_str());
+        while (!lsl_wait_for_consumers(outlet, 1) && !IsStopRequested()); // Poll so Ctrl+C is honoured
+        printf("%s: now sending data...\n", source_id.c_str());
+    }
+
+    // A recording's timestamps need no mapping; the model stays empty and passes them through
+    ClockModel clock_model;
+    CaptureSource source;
+    source.playback = playback;
+    BodyOutletPool body_outlets(source_id, outlet != NULL && options.stream.body_outlets ? config.body_slots : 0,
+        GetFramesPerSecond(record_config.camera_fps), options.stream);
+
+    int result = 0;
+    const double started = lsl_local_clock();
+    uint64_t published = 0;
+    {
+        SkeletonPipeline pipeline(source, tracker, sensor_calibration, outlet, &clock_model, &body_outlets, config);
+        if (output_path != NULL)
+        {
+            pipeline.AttachFileWriter(&writer);
+        }
+        result = pipeline.Run();
+        published = pipeline.GetPublishedFrames();
+    }
+    const double elapsed = lsl_local_clock() - started;
+    if (output_path != NULL && !writer.Close())
+    {
+        result = -1;
+    }
+    if (!quiet)
+    {
+        printf("%s: tracked %llu frames of %.1f s in %.1f s, %.2fx real time\n", source_id.c_str(), (unsigned long long)published,
+            length_usec * 1e-6, elapsed, elapsed > 0 ? length_usec * 1e-6 / elapsed : 0.0);
+    }
+    if (progress != NULL)
+    {
+        progress->length_s = length_usec * 1e-6;
+        progress->elapsed_s = elapsed;
+    }
+
+    if (outlet != NULL)
+    {
+        lsl_destroy_outlet(outlet);
+    }
+    k4abt_tracker_destroy(tracker);
+    k4a_playback_close(playback);
+    return result;
+}
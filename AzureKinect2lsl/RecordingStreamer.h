@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include "Options.h"
+
+// Source id for the streams of a recording: its file name without directory and extension
+std::string GetRecordingSourceId(const char* path);
+
+// How far StreamRecording has got with its file; the counters may be read from other threads meanwhile
+struct RecordingProgress
+{
+    std::atomic<uint64_t> expected_frames{ 0 }; // Length times frame rate, set once the recording is open
+    std::atomic<uint64_t> frames{ 0 };          // Frames written to the output file so far
+    double length_s = 0;                        // Set when StreamRecording returns
+    double elapsed_s = 0;
+};
+
+/**
+ * Tracks every capture with depth in the recording as fast as the tracker allows and publishes the
+ * skeletons on LSL, or writes them to output_path as CSV if that is given. Nothing is dropped, and
+ * unless the timestamp source is TIMESTAMP_SOURCE_POP the timestamps are the recording's own device
+ * timestamps in seconds, so reruns of one file line up. Recordings carry no system timestamps, so
+ * ParseOptions rejects TIMESTAMP_SOURCE_SYSTEM here.
+ * The tracker is created from the calibration stored in the recording, on the GPU with a fallback to
+ * the CPU unless cpu_tracker asks for the CPU straight away. progress may be NULL.
+ * Returns the pipeline's result, or -1 if the recording, the tracker or the output could not be set up.
+ */
+int StreamRecording(const char* path, const char* output_path, const StreamerOptions& options,
+    bool cpu_tracker = false, RecordingProgress* progress = NULL);
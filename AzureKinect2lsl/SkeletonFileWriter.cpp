@@ -0,0 +1,93 @@
+#include "SkeletonFileWriter.h"
+
+#include <algorithm>
+#include "BodySlots.h"
+#include "BodyTrackingHelpers.h"
+
+// Rows are small; a large stdio buffer keeps the writes to the disk few
+#define FILE_WRITER_BUFFER_BYTES (1 << 20)
+
+SkeletonFileWriter::SkeletonFileWriter(const std::string& source_id, int body_slots)
+    : m_sourceId(source_id), m_bodySlots(std::min(std::max(body_slots, 1), MAX_BODY_SLOTS)),
+      m_channelCount(m_bodySlots * g_skeletonChannelCount)
+{
+}
+
+SkeletonFileWriter::~SkeletonFileWriter()
+{
+    if (m_file != NULL)
+    {
+        fclose(m_file);
+    }
+}
+
+bool SkeletonFileWriter::Open(const char* path)
+{
+    m_path = path;
+#if defined(_MSC_VER)
+    // fopen is deprecated under /sdl
+    if (fopen_s(&m_file, path, "w") != 0)
+    {
+        m_file = NULL;
+    }
+#else
+    m_file = fopen(path, "w");
+#endif
+    if (m_file == NULL)
+    {
+        printf("%s: cannot create %s\n", m_sourceId.c_str(), path);
+        return false;
+    }
+    setvbuf(m_file, NULL, _IOFBF, FILE_WRITER_BUFFER_BYTES);
+
+    // The same channel names as the skeleton stream's description
+    fputs("timestamp", m_file);
+    for (int slot = 0; slot < m_bodySlots; slot++)
+    {
+        std::string prefix = m_bodySlots > 1 ? "BODY" + std::to_string(slot + 1) + "_" : "";
+        for (const char* joint_name : g_jointNames)
+        {
+            for (const char* suffix : g_jointChannelSuffixes)
+            {
+                fprintf(m_file, ",%s%s%s", prefix.c_str(), joint_name, suffix);
+            }
+        }
+    }
+    fputc('\n', m_file);
+    return true;
+}
+
+void SkeletonFileWriter::Write(const float* data, const double* timestamps, size_t frames)
+{
+    for (size_t frame = 0; frame < frames; frame++)
+    {
+        fprintf(m_file, "%.6f", timestamps[frame]);
+        const float* values = data + frame * m_channelCount;
+        for (size_t channel = 0; channel < m_channelCount; channel++)
+        {
+            fprintf(m_file, ",%g", values[channel]);
+        }
+        fputc('\n', m_file);
+    }
+    m_writtenFrames += frames;
+    if (m_frameCounter != NULL)
+    {
+        m_frameCounter->fetch_add(frames, std::memory_order_relaxed);
+    }
+}
+
+bool SkeletonFileWriter::Close()
+{
+    if (m_file == NULL)
+    {
+        return false;
+    }
+    bool ok = ferror(m_file) == 0;
+    ok &= fclose(m_file) == 0;
+    m_file = NULL;
+    if (!ok)
+    {
+        printf("%s: failed to write %s\n", m_sourceId.c_str(), m_path.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * Writes packed skeletons to a CSV file instead of, or next to, an LSL outlet: a header row with
+ * "timestamp" and the skeleton stream's channel names, then one row per frame with the timestamp in
+ * seconds and every channel, nan for empty slots. Rows are written by the publisher thread only.
+ */
+class SkeletonFileWriter
+{
+public:
+    // source_id names the streams and reports of a pipeline that has no outlet
+    SkeletonFileWriter(const std::string& source_id, int body_slots);
+    ~SkeletonFileWriter();
+
+    // Creates the file and writes the header. Prints the problem and returns false if it cannot.
+    bool Open(const char* path);
+
+    // Appends frames packed skeletons with their timestamps
+    void Write(const float* data, const double* timestamps, size_t frames);
+
+    // Closes the file. Prints the problem and returns false if any row failed to be written.
+    bool Close();
+
+    // Also adds every written frame to this counter, which other threads may read meanwhile
+    void SetFrameCounter(std::atomic<uint64_t>* counter) { m_frameCounter = counter; }
+
+    const std::string& GetSourceId() const { return m_sourceId; }
+    uint64_t GetWrittenFrames() const { return m_writtenFrames; }
+
+private:
+    std::string m_sourceId;
+    std::string m_path;
+    int m_bodySlots;
+    size_t m_channelCount;
+    FILE* m_file = NULL;
+    uint64_t m_writtenFrames = 0;
+    std::atomic<uint64_t>* m_frameCounter = NULL;
+};
@@ -0,0 +1,415 @@
+#include "SkeletonFusion.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include "BodyTrackingHelpers.h"
+
+// How much a joint of each confidence level counts. LOW marks joints the tracker predicted while
+// they were occluded, which are what fusion is there to replace.
+static const float g_confidenceWeights[K4ABT_JOINT_CONFIDENCE_LEVELS_COUNT] = { 0.0f, 0.2f, 1.0f, 1.0f };
+
+bool LoadExtrinsics(const char* path, const std::vector<std::string>& source_ids, std::vector<Extrinsics>& extrinsics)
+{
+    extrinsics.assign(source_ids.size(), Extrinsics());
+    std::ifstream file(path);
+    if (!file)
+    {
+        printf("Cannot open extrinsics file %s\n", path);
+        return false;
+    }
+
+    std::vector<bool> found(source_ids.size(), false);
+    std::string line;
+    int line_number = 0;
+    bool ok = true;
+    while (ok && std::getline(file, line))
+    {
+        line_number++;
+        std::istringstream fields(line);
+        std::string id;
+        if (!(fields >> id) || id[0] == '#')
+        {
+            continue;
+        }
+        Extrinsics parsed;
+        float* r = parsed.rotation;
+        float* t = parsed.translation;
+        for (int i = 0; i < 9; i++)
+        {
+            fields >> r[i];
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            fields >> t[i];
+        }
+        if (fields.fail())
+        {
+            printf("%s:%d: expected a source_id, 9 rotation and 3 translation values\n", path, line_number);
+            ok = false;
+            break;
+        }
+        // R * R^T must be the identity, or the transform would distort the skeleton
+        for (int i = 0; i < 3 && ok; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                float dot = r[i * 3] * r[j * 3] + r[i * 3 + 1] * r[j * 3 + 1] + r[i * 3 + 2] * r[j * 3 + 2];
+                if (fabsf(dot - (i == j ? 1.0f : 0.0f)) > 0.01f)
+                {
+                    printf("%s:%d: the rotation of %s is not orthonormal\n", path, line_number, id.c_str());
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        // An orthonormal matrix with determinant -1 is a reflection, which would swap left and right
+        const float determinant = r[0] * (r[4] * r[8] - r[5] * r[7]) - r[1] * (r[3] * r[8] - r[5] * r[6]) +
+            r[2] * (r[3] * r[7] - r[4] * r[6]);
+        if (ok && fabsf(determinant - 1.0f) > 0.01f)
+        {
+            printf("%s:%d: the rotation of %s is a reflection, not a rotation\n", path, line_number, id.c_str());
+            ok = false;
+        }
+        for (size_t device = 0; ok && device < source_ids.size(); device++)
+        {
+            if (source_ids[device] == id)
+            {
+                extrinsics[device] = parsed;
+                found[device] = true;
+            }
+        }
+    }
+
+    for (size_t device = 0; ok && device < source_ids.size(); device++)
+    {
+        if (!found[device])
+        {
+            printf("No extrinsics for %s in %s, using its camera frame as the world frame\n", source_ids[device].c_str(), path);
+        }
+    }
+    return ok;
+}
+
+// Rotation matrix (row-major) to the unit quaternion w, x, y, z
+static void RotationToQuaternion(const float* m, float* q)
+{
+    const float trace = m[0] + m[4] + m[8];
+    if (trace > 0.0f)
+    {
+        const float s = sqrtf(trace + 1.0f) * 2.0f;
+        q[0] = 0.25f * s;
+        q[1] = (m[7] - m[5]) / s;
+        q[2] = (m[2] - m[6]) / s;
+        q[3] = (m[3] - m[1]) / s;
+    }
+    else if (m[0] > m[4] && m[0] > m[8])
+    {
+        const float s = sqrtf(1.0f + m[0] - m[4] - m[8]) * 2.0f;
+        q[0] = (m[7] - m[5]) / s;
+        q[1] = 0.25f * s;
+        q[2] = (m[1] + m[3]) / s;
+        q[3] = (m[2] + m[6]) / s;
+    }
+    else if (m[4] > m[8])
+    {
+        const float s = sqrtf(1.0f + m[4] - m[0] - m[8]) * 2.0f;
+        q[0] = (m[2] - m[6]) / s;
+        q[1] = (m[1] + m[3]) / s;
+        q[2] = 0.25f * s;
+        q[3] = (m[5] + m[7]) / s;
+    }
+    else
+    {
+        const float s = sqrtf(1.0f + m[8] - m[0] - m[4]) * 2.0f;
+        q[0] = (m[3] - m[1]) / s;
+        q[1] = (m[2] + m[6]) / s;
+        q[2] = (m[5] + m[7]) / s;
+        q[3] = 0.25f * s;
+    }
+}
+
+static inline void TransformPoint(const Extrinsics& extrinsics, const float* p, float* out)
+{
+    const float* r = extrinsics.rotation;
+    out[0] = r[0] * p[0] + r[1] * p[1] + r[2] * p[2] + extrinsics.translation[0];
+    out[1] = r[3] * p[0] + r[4] * p[1] + r[5] * p[2] + extrinsics.translation[1];
+    out[2] = r[6] * p[0] + r[7] * p[1] + r[8] * p[2] + extrinsics.translation[2];
+}
+
+static inline float DistanceSquared(const float* a, const float* b)
+{
+    const float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+SkeletonFusion::SkeletonFusion(const std::vector<Extrinsics>& extrinsics, int body_slots)
+    : m_extrinsics(extrinsics), m_rotationQuaternions(extrinsics.size() * 4),
+      m_slotCount(std::min(std::max(body_slots, 1), MAX_BODY_SLOTS))
+{
+    for (size_t device = 0; device < extrinsics.size(); device++)
+    {
+        RotationToQuaternion(extrinsics[device].rotation, &m_rotationQuaternions[device * 4]);
+    }
+    std::fill(m_slotIds, m_slotIds + MAX_BODY_SLOTS, K4ABT_INVALID_BODY_ID);
+    m_views.reserve(extrinsics.size() * MAX_BODY_SLOTS);
+    m_clusters.reserve(extrinsics.size() * MAX_BODY_SLOTS);
+}
+
+int SkeletonFusion::Fuse(const DeviceFrame* const* frames, int device_count, float* out, uint32_t* body_ids)
+{
+    // Every body every device sees, with its pelvis in the world frame and how squarely it faces the camera
+    m_views.clear();
+    device_count = std::min<int>(device_count, (int)m_extrinsics.size());
+    for (int device = 0; device < device_count; device++)
+    {
+        const DeviceFrame* frame = frames[device];
+        if (frame == NULL)
+        {
+            continue;
+        }
+        for (int slot = 0; slot < frame->body_slots; slot++)
+        {
+            if (frame->body_ids[slot] == K4ABT_INVALID_BODY_ID)
+            {
+                continue;
+            }
+            const float* joints = frame->joints + slot * g_skeletonChannelCount;
+            const float* pelvis = joints + K4ABT_JOINT_PELVIS * g_channelsPerJoint;
+            if (pelvis[0] != pelvis[0])
+            {
+                continue;
+            }
+            View view;
+            view.device = device;
+            view.joints = joints;
+            view.confidence = frame->confidence + slot * K4ABT_JOINT_COUNT;
+            view.cluster = -1;
+            TransformPoint(m_extrinsics[device], pelvis, view.pelvis);
+
+            // The body faces along (left shoulder - right shoulder) x (neck - pelvis); compare that
+            // with the direction from the pelvis to the camera, which sits at the origin
+            const float* left = joints + K4ABT_JOINT_SHOULDER_LEFT * g_channelsPerJoint;
+            const float* right = joints + K4ABT_JOINT_SHOULDER_RIGHT * g_channelsPerJoint;
+            const float* neck = joints + K4ABT_JOINT_NECK * g_channelsPerJoint;
+            const float ax = left[0] - right[0], ay = left[1] - right[1], az = left[2] - right[2];
+            const float ux = neck[0] - pelvis[0], uy = neck[1] - pelvis[1], uz = neck[2] - pelvis[2];
+            const float nx = ay * uz - az * uy, ny = az * ux - ax * uz, nz = ax * uy - ay * ux;
+            float facing = -(nx * pelvis[0] + ny * pelvis[1] + nz * pelvis[2]) /
+                sqrtf((nx * nx + ny * ny + nz * nz) * (pelvis[0] * pelvis[0] + pelvis[1] * pelvis[1] + pelvis[2] * pelvis[2]));
+            if (facing != facing)
+            {
+                facing = 0.5f; // Shoulders or neck gated out: neither front nor back
+            }
+            view.weight = FUSION_MIN_VIEW_WEIGHT + (1.0f - FUSION_MIN_VIEW_WEIGHT) * std::max(facing, 0.0f);
+            m_views.push_back(view);
+        }
+    }
+
+    // Group the views into bodies: each joins the nearest body within reach that its device has not seen yet
+    const float match_squared = FUSION_MATCH_DISTANCE_MM * FUSION_MATCH_DISTANCE_MM;
+    m_clusters.clear();
+    for (int i = 0; i < (int)m_views.size(); i++)
+    {
+        View& view = m_views[i];
+        int best = -1;
+        float best_squared = match_squared;
+        for (int c = 0; c < (int)m_clusters.size(); c++)
+        {
+            const float distance_squared = DistanceSquared(view.pelvis, m_clusters[c].pelvis);
+            if ((m_clusters[c].devices & (1u << view.device)) == 0 && distance_squared < best_squared)
+            {
+                best = c;
+                best_squared = distance_squared;
+            }
+        }
+        if (best < 0)
+        {
+            best = (int)m_clusters.size();
+            m_clusters.push_back({ { view.pelvis[0], view.pelvis[1], view.pelvis[2] }, 0, 0, -1 });
+        }
+        Cluster& cluster = m_clusters[best];
+        cluster.views++;
+        cluster.devices |= 1u << view.device;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            cluster.pelvis[axis] += (view.pelvis[axis] - cluster.pelvis[axis]) / cluster.views;
+        }
+        view.cluster = best;
+    }
+
+    // Bodies stay in their slot while they stay close to where they were; the rest take free slots
+    bool slot_taken[MAX_BODY_SLOTS] = {};
+    for (int slot = 0; slot < m_slotCount; slot++)
+    {
+        if (m_slotIds[slot] == K4ABT_INVALID_BODY_ID)
+        {
+            continue;
+        }
+        int best = -1;
+        float best_squared = match_squared;
+        for (int c = 0; c < (int)m_clusters.size(); c++)
+        {
+            const float distance_squared = DistanceSquared(m_slotPelvis[slot], m_clusters[c].pelvis);
+            if (m_clusters[c].slot < 0 && distance_squared < best_squared)
+            {
+                best = c;
+                best_squared = distance_squared;
+            }
+        }
+        if (best >= 0)
+        {
+            m_clusters[best].slot = slot;
+            slot_taken[slot] = true;
+        }
+        else
+        {
+            m_slotIds[slot] = K4ABT_INVALID_BODY_ID;
+        }
+    }
+    int left_out = 0;
+    for (Cluster& cluster : m_clusters)
+    {
+        if (cluster.slot >= 0)
+        {
+            continue;
+        }
+        for (int slot = 0; slot < m_slotCount && cluster.slot < 0; slot++)
+        {
+            if (!slot_taken[slot])
+            {
+                cluster.slot = slot;
+                slot_taken[slot] = true;
+                m_slotIds[slot] = m_nextBodyId++;
+            }
+        }
+        left_out += cluster.slot < 0;
+    }
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int slot = 0; slot < m_slotCount; slot++)
+    {
+        float* joints = out + slot * g_skeletonChannelCount;
+        body_ids[slot] = slot_taken[slot] ? m_slotIds[slot] : K4ABT_INVALID_BODY_ID;
+        if (!slot_taken[slot])
+        {
+            std::fill(joints, joints + g_skeletonChannelCount, nan);
+        }
+    }
+    for (int c = 0; c < (int)m_clusters.size(); c++)
+    {
+        const int slot = m_clusters[c].slot;
+        if (slot >= 0)
+        {
+            float* joints = out + slot * g_skeletonChannelCount;
+            FuseCluster(c, joints);
+            const float* pelvis = joints + K4ABT_JOINT_PELVIS * g_channelsPerJoint;
+            memcpy(m_slotPelvis[slot], pelvis[0] == pelvis[0] ? pelvis : m_clusters[c].pelvis, sizeof(m_slotPelvis[slot]));
+        }
+    }
+    return left_out;
+}
+
+// Weighted mean of the views of one body, joint by joint, in the world frame
+void SkeletonFusion::FuseCluster(int cluster, float* out) const
+{
+    // A body has at most one view per device
+    const View* views[FRAME_SET_MAX_DEVICES];
+    int view_count = 0;
+    for (const View& view : m_views)
+    {
+        if (view.cluster == cluster && view_count < FRAME_SET_MAX_DEVICES)
+        {
+            views[view_count++] = &view;
+        }
+    }
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        float position[3] = { 0, 0, 0 };
+        float orientation[4] = { 0, 0, 0, 0 };
+        float position_weight = 0;
+        float orientation_weight = 0;
+        for (int i = 0; i < view_count; i++)
+        {
+            const View& view = *views[i];
+            const float* channels = view.joints + joint * g_channelsPerJoint;
+            const uint8_t level = std::min<uint8_t>(view.confidence[joint], K4ABT_JOINT_CONFIDENCE_LEVELS_COUNT - 1);
+            const float weight = g_confidenceWeights[level] * view.weight;
+            if (weight <= 0.0f)
+            {
+                continue;
+            }
+            if (channels[0] == channels[0])
+            {
+                float world[3];
+                TransformPoint(m_extrinsics[view.device], channels, world);
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    position[axis] += weight * world[axis];
+                }
+                position_weight += weight;
+            }
+            if (channels[3] == channels[3])
+            {
+                // Rotate into the world frame, then onto the same hemisphere as the sum so far
+                const float* r = &m_rotationQuaternions[view.device * 4];
+                const float* q = channels + 3;
+                float world[4] = {
+                    r[0] * q[0] - r[1] * q[1] - r[2] * q[2] - r[3] * q[3],
+                    r[0] * q[1] + r[1] * q[0] + r[2] * q[3] - r[3] * q[2],
+                    r[0] * q[2] - r[1] * q[3] + r[2] * q[0] + r[3] * q[1],
+                    r[0] * q[3] + r[1] * q[2] - r[2] * q[1] + r[3] * q[0],
+                };
+                const float dot = orientation[0] * world[0] + orientation[1] * world[1] + orientation[2] * world[2] + orientation[3] * world[3];
+                const float signed_weight = dot < 0.0f ? -weight : weight;
+                for (int k = 0; k < 4; k++)
+                {
+                    orientation[k] += signed_weight * world[k];
+                }
+                orientation_weight += weight;
+            }
+        }
+
+        float* channels = out + joint * g_channelsPerJoint;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            channels[axis] = position_weight > 0.0f ? position[axis] / position_weight : nan;
+        }
+        const float norm = sqrtf(orientation[0] * orientation[0] + orientation[1] * orientation[1] +
+            orientation[2] * orientation[2] + orientation[3] * orientation[3]);
+        for (int k = 0; k < 4; k++)
+        {
+            channels[3 + k] = orientation_weight > 0.0f && norm > 0.0f ? orientation[k] / norm : nan;
+        }
+    }
+}
+
+void AppendFusionMetadata(lsl_streaminfo info, const std::vector<std::string>& source_ids, const std::vector<Extrinsics>& extrinsics)
+{
+    lsl_xml_ptr fusion = lsl_append_child(lsl_get_desc(info), "fusion");
+    lsl_append_child_value(fusion, "weights", "confidence level times view angle");
+    lsl_append_child_value(fusion, "coordinate_frame", "world, mm");
+    for (size_t device = 0; device < source_ids.size() && device < extrinsics.size(); device++)
+    {
+        lsl_xml_ptr node = lsl_append_child(fusion, "device");
+        lsl_append_child_value(node, "source_id", source_ids[device].c_str());
+        std::string rotation;
+        for (int i = 0; i < 9; i++)
+        {
+            rotation += (i > 0 ? " " : "") + std::to_string(extrinsics[device].rotation[i]);
+        }
+        std::string translation;
+        for (int i = 0; i < 3; i++)
+        {
+            translation += (i > 0 ? " " : "") + std::to_string(extrinsics[device].translation[i]);
+        }
+        lsl_append_child_value(node, "rotation", rotation.c_str());
+        lsl_append_child_value(node, "translation", translation.c_str());
+    }
+}
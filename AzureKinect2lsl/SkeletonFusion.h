@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <lsl_cpp.h>
+#include <k4abttypes.h>
+#include "BodySlots.h"
+#include "FrameSetCollector.h"
+
+#define FUSION_MATCH_DISTANCE_MM 500.0f // Views of one body have their pelvises at most this far apart
+#define FUSION_MIN_VIEW_WEIGHT 0.1f     // Weight of a view from behind; a view from the front weighs 1
+
+// Rigid transform from a device's depth camera coordinates into the shared world frame:
+// world = rotation * camera + translation, rotation row-major, both in mm.
+struct Extrinsics
+{
+    float rotation[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    float translation[3] = { 0, 0, 0 };
+};
+
+/**
+ * Reads the extrinsics of these devices from a text file with one line per device: its source_id
+ * followed by the 9 rotation and 3 translation values, whitespace separated. Blank lines and lines
+ * starting with # are skipped. A device without a line keeps the identity, so the first camera can
+ * define the world frame. Prints the problem and returns false if the file cannot be read or a
+ * line is malformed.
+ */
+bool LoadExtrinsics(const char* path, const std::vector<std::string>& source_ids, std::vector<Extrinsics>& extrinsics);
+
+/**
+ * Fuses the skeletons of one frame set into the shared world frame. The views of a body are found
+ * by their pelvis positions, and every joint is the weighted mean of the views that see it:
+ * confidence level times a view weight that falls from 1 for a camera the body faces to
+ * FUSION_MIN_VIEW_WEIGHT for one behind it. Orientations are averaged the same way after
+ * rotating them into the world frame. Fused bodies keep their slot for as long as they stay within
+ * FUSION_MATCH_DISTANCE_MM of where they were, and get ids of their own.
+ */
+class SkeletonFusion
+{
+public:
+    SkeletonFusion(const std::vector<Extrinsics>& extrinsics, int body_slots);
+
+    int GetSlotCount() const { return m_slotCount; }
+
+    // frames has one entry per device, NULL for a device missing from the set. Writes body_slots
+    // packed skeletons, NaN for empty slots, and the fused body ids. Returns the bodies left out
+    // because every slot was taken.
+    int Fuse(const DeviceFrame* const* frames, int device_count, float* out, uint32_t* body_ids);
+
+private:
+    struct View
+    {
+        int device;
+        const float* joints;
+        const uint8_t* confidence;
+        float pelvis[3]; // In the world frame
+        float weight;    // View angle weight of the whole body
+        int cluster;
+    };
+
+    struct Cluster
+    {
+        float pelvis[3];
+        int views;
+        uint32_t devices; // Bit per device, so a device contributes one view per body
+        int slot;
+    };
+
+    void FuseCluster(int cluster, float* out) const;
+
+    std::vector<Extrinsics> m_extrinsics;
+    std::vector<float> m_rotationQuaternions; // w, x, y, z per device
+    int m_slotCount;
+    uint32_t m_slotIds[MAX_BODY_SLOTS];
+    float m_slotPelvis[MAX_BODY_SLOTS][3];
+    uint32_t m_nextBodyId = 1;
+
+    // Scratch, sized for every device seeing MAX_BODY_SLOTS bodies
+    std::vector<View> m_views;
+    std::vector<Cluster> m_clusters;
+};
+
+// Adds a <fusion> node with the source_id and extrinsics of every device to the stream description
+void AppendFusionMetadata(lsl_streaminfo info, const std::vector<std::string>& source_ids, const std::vector<Extrinsics>& extrinsics);
@@ -0,0 +1,103 @@
+#include "SkeletonPacker.h"
+
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PACK_KERNEL_AVX
+#define PACK_KERNEL_SIMD
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PACK_KERNEL_SSE
+#define PACK_KERNEL_SIMD
+#endif
+
+// The SIMD kernels read a joint as 8 consecutive floats: position xyz, orientation wxyz and the
+// confidence level. The first 7 are exactly the packed channels of the joint.
+static_assert(sizeof(k4abt_joint_t) == 8 * sizeof(float), "Unexpected k4abt_joint_t layout");
+static_assert(g_channelsPerJoint == 7, "Kernels assume 7 channels per joint");
+
+void PackSkeletonScalar(const k4abt_skeleton_t& skeleton, float* data)
+{
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        const k4a_float3_t& position = skeleton.joints[joint].position;
+        const k4a_quaternion_t& orientation = skeleton.joints[joint].orientation;
+        float* out = data + joint * g_channelsPerJoint;
+
+        out[0] = position.xyz.x;
+        out[1] = position.xyz.y;
+        out[2] = position.xyz.z;
+        out[3] = orientation.wxyz.w;
+        out[4] = orientation.wxyz.x;
+        out[5] = orientation.wxyz.y;
+        out[6] = orientation.wxyz.z;
+    }
+}
+
+// Each joint is copied with full-width stores that spill the confidence level into the first
+// channel of the next joint; the next store overwrites it. The last joint is copied by hand so
+// nothing is written past the end of data.
+void PackSkeleton(const k4abt_skeleton_t& skeleton, float* data)
+{
+#if defined(PACK_KERNEL_SIMD)
+    const float* in = reinterpret_cast<const float*>(skeleton.joints);
+    const int last = K4ABT_JOINT_COUNT - 1;
+
+#if defined(PACK_KERNEL_AVX)
+    for (int joint = 0; joint < last; joint++)
+    {
+        _mm256_storeu_ps(data + joint * 7, _mm256_loadu_ps(in + joint * 8));
+    }
+#elif defined(PACK_KERNEL_SSE)
+    for (int joint = 0; joint < last; joint++)
+    {
+        __m128 position_w = _mm_loadu_ps(in + joint * 8);
+        __m128 xyz_confidence = _mm_loadu_ps(in + joint * 8 + 4);
+        _mm_storeu_ps(data + joint * 7, position_w);
+        _mm_storeu_ps(data + joint * 7 + 4, xyz_confidence);
+    }
+#endif
+
+    for (int k = 0; k < 7; k++)
+    {
+        data[last * 7 + k] = in[last * 8 + k];
+    }
+#else
+    PackSkeletonScalar(skeleton, data);
+#endif
+}
+
+void PackConfidence(const k4abt_skeleton_t& skeleton, uint8_t* confidence)
+{
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        confidence[joint] = (uint8_t)skeleton.joints[joint].confidence_level;
+    }
+}
+
+void GateByConfidence(const k4abt_skeleton_t& skeleton, k4abt_joint_confidence_level_t min_confidence, float* data)
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int joint = 0; joint < K4ABT_JOINT_COUNT; joint++)
+    {
+        if (skeleton.joints[joint].confidence_level < min_confidence)
+        {
+            float* out = data + joint * g_channelsPerJoint;
+            out[0] = nan;
+            out[1] = nan;
+            out[2] = nan;
+        }
+    }
+}
+
+const char* GetPackKernelName()
+{
+#if defined(PACK_KERNEL_AVX)
+    return "avx";
+#elif defined(PACK_KERNEL_SSE)
+    return "sse";
+#else
+    return "scalar";
+#endif
+}
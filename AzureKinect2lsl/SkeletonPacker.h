@@ -0,0 +1,20 @@
+#pragma once
+
+#include <k4abttypes.h>
+#include "BodyTrackingHelpers.h"
+
+// Packs one skeleton into g_skeletonChannelCount floats (layout documented next to g_jointNames),
+// using the widest SIMD kernel the build targets.
+void PackSkeleton(const k4abt_skeleton_t& skeleton, float* data);
+
+// Plain per-field copy. Used where no SIMD kernel is available and as the benchmark baseline.
+void PackSkeletonScalar(const k4abt_skeleton_t& skeleton, float* data);
+
+// Name of the kernel PackSkeleton dispatches to ("avx", "sse" or "scalar").
+const char* GetPackKernelName();
+
+// Writes the confidence level of every joint, one byte per joint in k4abt_joint_id_t order.
+void PackConfidence(const k4abt_skeleton_t& skeleton, uint8_t* confidence);
+
+// Replaces the packed position of every joint below min_confidence with NaN; orientations are kept.
+void GateByConfidence(const k4abt_skeleton_t& skeleton, k4abt_joint_confidence_level_t min_confidence, float* data);
@@ -0,0 +1,1076 @@
+#include "SkeletonPipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+#include "BodyIndexStream.h"
+#include "SkeletonPacker.h"
+#include "StopSignal.h"
+
+// Finite timeouts keep every thread responsive to shutdown and to overload handling
+#define CAPTURE_TIMEOUT_MS 1000
+#define FEED_TIMEOUT_MS 5
+#define POP_TIMEOUT_MS 1000
+
+// Highest rate the camera delivers, used to size time-based chunks
+#define MAX_CAMERA_FPS 30
+
+// Captures accepted by the tracker but not yet popped; the tracker itself only queues a few
+#define ACCEPTED_RING_CAPACITY 64
+
+// Encoded body index maps waiting for the publisher, and the seconds of them the outlet buffers
+#define BODY_INDEX_RING_CAPACITY 8
+#define BODY_INDEX_MAX_BUFFERED 10
+
+// Seconds of data the per-frame side streams buffer, the skeleton stream's default
+#define SIDE_STREAM_MAX_BUFFERED 60
+
+// Body frames waiting for the point cloud thread, and the seconds of clouds the outlet buffers
+#define CLOUD_RING_CAPACITY 4
+#define CLOUD_MAX_BUFFERED 10
+
+// Multi-line reports from the pipelines of several devices must not interleave
+static std::mutex g_reportMutex;
+
+// A capture waiting in the capture thread's backlog
+struct PendingCapture
+{
+    k4a_capture_t capture;
+    double arrival;
+    uint64_t device_usec;
+};
+
+const char* GetOverloadPolicyName(overload_policy_t policy)
+{
+    switch (policy)
+    {
+    case OVERLOAD_POLICY_BLOCK:       return "block";
+    case OVERLOAD_POLICY_DROP_OLDEST: return "drop-oldest";
+    case OVERLOAD_POLICY_DROP_NEWEST: return "drop-newest";
+    case OVERLOAD_POLICY_KEEP_LATEST: return "keep-latest";
+    default:                          return "unknown";
+    }
+}
+
+SkeletonPipeline::SkeletonPipeline(const CaptureSource& source, k4abt_tracker_t tracker, const k4a_calibration_t& calibration,
+    lsl_outlet outlet, ClockModel* clock_model, BodyOutletPool* body_outlets, const PipelineConfig& config)
+    : m_source(source), m_tracker(tracker), m_calibration(calibration), m_outlet(outlet), m_clockModel(clock_model), m_bodyOutlets(body_outlets), m_config(config),
+      m_channelCount(std::min(std::max(config.body_slots, 1), MAX_BODY_SLOTS) * g_skeletonChannelCount),
+      m_bodySlots(config.body_slots), m_confidenceCount(m_bodySlots.GetSlotCount() * K4ABT_JOINT_COUNT), m_primarySelector(config.primary_selection, config.selection_volume),
+      m_frameSkeletons(MAX_FRAME_BODIES), m_publishRing(config.publish_ring_capacity), m_acceptedRing(ACCEPTED_RING_CAPACITY),
+      m_bodyIndexRing(BODY_INDEX_RING_CAPACITY), m_cloudRing(CLOUD_RING_CAPACITY)
+{
+    if (config.lossless)
+    {
+        m_config.overload_policy = OVERLOAD_POLICY_BLOCK;
+    }
+    if (outlet == NULL)
+    {
+        // Writing to a file only: the side streams have no skeleton stream to hang off
+        m_config.metrics_stream = false;
+        m_config.confidence_stream = false;
+        m_config.kinematics_stream = false;
+        m_config.angle_stream = false;
+        m_config.bone_stream = false;
+        m_config.constrained_stream = false;
+        m_config.body_index_stream = false;
+        m_config.point_cloud_voxel_mm = 0;
+    }
+
+    // One block for the joints of every ring slot, so nothing is allocated while bodies come and go
+    m_recordJoints.resize(m_publishRing.GetStats().capacity * m_channelCount);
+    m_recordConfidence.resize(m_publishRing.GetStats().capacity * m_confidenceCount);
+    if (config.smoothed_outlets != 0)
+    {
+        m_smoother.reset(new JointSmoother(m_bodySlots.GetSlotCount(), config.smoothing));
+        m_recordSmoothed.resize(m_recordJoints.size());
+    }
+    float* joints = m_recordJoints.data();
+    float* smoothed = m_smoother ? m_recordSmoothed.data() : NULL;
+    uint8_t* confidence = m_recordConfidence.data();
+    m_publishRing.ForEachSlot([&](SkeletonRecord& record)
+    {
+        record.joints = joints;
+        record.smoothed = smoothed;
+        record.confidence = confidence;
+        joints += m_channelCount;
+        smoothed += smoothed != NULL ? m_channelCount : 0;
+        confidence += m_confidenceCount;
+    });
+
+    m_chunkCapacity = std::max(config.chunk_frames, 1);
+    if (config.chunk_ms > 0 && config.chunk_frames <= 1)
+    {
+        m_chunkCapacity = config.chunk_ms * MAX_CAMERA_FPS / 1000 + 1;
+    }
+    m_chunkData.resize(m_chunkCapacity * m_channelCount);
+    m_chunkTimestamps.resize(m_chunkCapacity);
+    m_chunkPopped.resize(m_chunkCapacity);
+    m_chunkConfidence.resize(m_chunkCapacity * m_confidenceCount);
+
+    // Side streams declare the skeleton stream's rate and derive their source ids from its own
+    double nominal_srate = 0;
+    if (outlet != NULL)
+    {
+        lsl_streaminfo skeleton_info = lsl_get_info(outlet);
+        nominal_srate = lsl_get_nominal_srate(skeleton_info);
+        m_sourceId = lsl_get_source_id(skeleton_info);
+        lsl_destroy_streaminfo(skeleton_info);
+    }
+
+    if (m_config.metrics_stream && config.stats_interval_s > 0)
+    {
+        m_metricsOutlet = lsl_create_outlet(CreateMetricsStreamInfo(m_sourceId, config.stats_interval_s), 0, 360);
+    }
+
+    if (m_config.confidence_stream)
+    {
+        m_confidenceOutlet = lsl_create_outlet(CreateConfidenceStreamInfo(m_sourceId, nominal_srate, m_bodySlots.GetSlotCount()),
+            0, SIDE_STREAM_MAX_BUFFERED);
+    }
+
+    if (m_config.kinematics_stream)
+    {
+        m_kinematics.reset(new JointKinematics(m_bodySlots.GetSlotCount()));
+        m_kinematicsData.resize(m_bodySlots.GetSlotCount() * KINEMATICS_CHANNEL_COUNT);
+        m_kinematicsOutlet = lsl_create_outlet(CreateKinematicsStreamInfo(m_sourceId, nominal_srate, m_bodySlots.GetSlotCount()),
+            0, SIDE_STREAM_MAX_BUFFERED);
+    }
+
+    if (m_config.angle_stream)
+    {
+        m_angleData.resize(m_bodySlots.GetSlotCount() * JOINT_ANGLE_COUNT);
+        m_angleOutlet = lsl_create_outlet(CreateJointAngleStreamInfo(m_sourceId, nominal_srate, m_bodySlots.GetSlotCount()), 0, SIDE_STREAM_MAX_BUFFERED);
+    }
+
+    if (m_config.bone_stream)
+    {
+        m_boneData.resize(m_bodySlots.GetSlotCount() * BONE_VECTOR_CHANNEL_COUNT);
+        m_boneOutlet = lsl_create_outlet(CreateBoneVectorStreamInfo(m_sourceId, nominal_srate, m_bodySlots.GetSlotCount()), 0, SIDE_STREAM_MAX_BUFFERED);
+    }
+
+    if (m_config.constrained_stream)
+    {
+        m_lengthFilter.reset(new BoneLengthFilter(m_bodySlots.GetSlotCount()));
+        m_constrainedData.resize(m_channelCount);
+        m_constrainedOutlet = lsl_create_outlet(CreateConstrainedStreamInfo(m_sourceId, nominal_srate, m_bodySlots.GetSlotCount()),
+            0, SIDE_STREAM_MAX_BUFFERED);
+    }
+
+    if (m_config.body_index_stream)
+    {
+        // The map has the depth camera's resolution; size every ring slot for the worst case
+        const int width = calibration.depth_camera_calibration.resolution_width;
+        const int height = calibration.depth_camera_calibration.resolution_height;
+        const size_t capacity = GetBodyIndexEncodedCapacity(width, height);
+        m_bodyIndexStorage.resize(m_bodyIndexRing.GetStats().capacity * capacity);
+        uint8_t* data = m_bodyIndexStorage.data();
+        m_bodyIndexRing.ForEachSlot([&](BodyIndexRecord& record)
+        {
+            record.data = data;
+            data += capacity;
+        });
+        m_bodyIndexSlots.resize((size_t)width * height);
+
+        m_bodyIndexOutlet = lsl_create_outlet(CreateBodyIndexStreamInfo(m_sourceId, nominal_srate, width, height), 0, BODY_INDEX_MAX_BUFFERED);
+    }
+
+    if (m_config.point_cloud_voxel_mm > 0)
+    {
+        // Builds the xy table, which takes a moment, so it is done before streaming starts
+        m_pointCloud.reset(new BodyPointCloud(calibration, (float)config.point_cloud_voxel_mm));
+        m_cloudData.resize(MAX_CLOUD_VOXELS * POINT_CLOUD_CHANNEL_COUNT);
+        m_pointCloudOutlet = lsl_create_outlet(CreatePointCloudStreamInfo(m_sourceId, (float)config.point_cloud_voxel_mm), 0, CLOUD_MAX_BUFFERED);
+    }
+}
+
+SkeletonPipeline::~SkeletonPipeline()
+{
+    if (m_metricsOutlet != NULL)
+    {
+        lsl_destroy_outlet(m_metricsOutlet);
+    }
+    if (m_confidenceOutlet != NULL)
+    {
+        lsl_destroy_outlet(m_confidenceOutlet);
+    }
+    if (m_kinematicsOutlet != NULL)
+    {
+        lsl_destroy_outlet(m_kinematicsOutlet);
+    }
+    if (m_angleOutlet != NULL)
+    {
+        lsl_destroy_outlet(m_angleOutlet);
+    }
+    if (m_boneOutlet != NULL)
+    {
+        lsl_destroy_outlet(m_boneOutlet);
+    }
+    if (m_constrainedOutlet != NULL)
+    {
+        lsl_destroy_outlet(m_constrainedOutlet);
+    }
+    if (m_bodyIndexOutlet != NULL)
+    {
+        lsl_destroy_outlet(m_bodyIndexOutlet);
+    }
+    if (m_pointCloudOutlet != NULL)
+    {
+        lsl_destroy_outlet(m_pointCloudOutlet);
+    }
+}
+
+void SkeletonPipeline::AttachFrameSets(FrameSetCollector* collector, int device)
+{
+    m_frameSets = collector;
+    m_frameSetDevice = device;
+}
+
+void SkeletonPipeline::AttachFileWriter(SkeletonFileWriter* writer)
+{
+    m_fileWriter = writer;
+    if (m_outlet == NULL)
+    {
+        m_sourceId = writer->GetSourceId();
+    }
+}
+
+int SkeletonPipeline::Run()
+{
+    if (!m_config.quiet)
+    {
+        printf("%s: overload policy: %s, timestamps: %s, body slots: %d, primary selection: %s\n", m_sourceId.c_str(),
+            GetOverloadPolicyName(m_config.overload_policy), GetTimestampSourceName(m_config.timestamp_source),
+            m_bodySlots.GetSlotCount(), GetPrimarySelectionName(m_config.primary_selection));
+    }
+
+    m_sessionStart = lsl_local_clock();
+    std::thread capture_thread(&SkeletonPipeline::CaptureLoop, this);
+    std::thread tracker_thread(&SkeletonPipeline::TrackerLoop, this);
+    std::thread publish_thread(&SkeletonPipeline::PublishLoop, this);
+    std::thread metrics_thread(&SkeletonPipeline::MetricsLoop, this);
+    std::thread point_cloud_thread(&SkeletonPipeline::PointCloudLoop, this);
+
+    capture_thread.join();
+    tracker_thread.join();
+    publish_thread.join();
+    metrics_thread.join();
+    point_cloud_thread.join();
+
+    if (!m_config.quiet)
+    {
+        PrintSessionSummary(lsl_local_clock() - m_sessionStart);
+    }
+
+    return m_failed ? -1 : 0;
+}
+
+// Totals for the whole run, so long sessions can be checked for steady throughput
+void SkeletonPipeline::PrintSessionSummary(double duration) const
+{
+    uint64_t dropped = 0;
+    for (int policy = 0; policy < OVERLOAD_POLICY_COUNT; policy++)
+    {
+        dropped += m_droppedCaptures[policy];
+    }
+    SpscRingStats ring_stats = m_publishRing.GetStats();
+    uint64_t published = m_publishedFrames;
+
+    int seconds = (int)duration;
+    std::lock_guard<std::mutex> lock(g_reportMutex); // Keeps the reports of several devices apart
+    printf("Session summary for %s (%dh %02dm %02ds):\n", m_sourceId.c_str(), seconds / 3600, seconds / 60 % 60, seconds % 60);
+    printf("  captured %llu, tracked %llu, published %llu, dropped %llu (%s policy) + %llu ring overruns\n",
+        (unsigned long long)m_capturedFrames, (unsigned long long)m_trackedFrames, (unsigned long long)published,
+        (unsigned long long)dropped, GetOverloadPolicyName(m_config.overload_policy), (unsigned long long)ring_stats.overruns);
+    if (m_unslottedBodies > 0)
+    {
+        printf("  %llu bodies were left out because all %d slots were taken\n", (unsigned long long)m_unslottedBodies,
+            m_bodySlots.GetSlotCount());
+    }
+    if (m_primarySelector.IsEnabled())
+    {
+        printf("  primary body (%s) changed hands %llu times\n", GetPrimarySelectionName(m_config.primary_selection),
+            (unsigned long long)m_primarySelector.GetSwitches());
+    }
+    printf("  achieved %.2f fps", duration > 0 ? published / duration : 0.0);
+    if (m_reportedIntervals > 0)
+    {
+        printf(", per-interval range %.2f - %.2f fps over %d intervals", m_minIntervalFps, m_maxIntervalFps, m_reportedIntervals);
+    }
+    printf("\n");
+
+    std::vector<LatencySnapshot> latency(PIPELINE_STAGE_COUNT);
+    for (int stage = 0; stage < PIPELINE_STAGE_COUNT; stage++)
+    {
+        m_latency[stage].Snapshot(&latency[stage]);
+        printf("  %-10s latency mean %7.2f  p99 %7.2f ms\n", GetPipelineStageName((pipeline_stage_t)stage),
+            latency[stage].MeanMs(), latency[stage].PercentileMs(99));
+    }
+
+    printf("  publish ring: capacity %zu, peak occupancy %zu\n", ring_stats.capacity, ring_stats.peak_occupancy);
+    if (m_bodyIndexOutlet != NULL)
+    {
+        SpscRingStats index_stats = m_bodyIndexRing.GetStats();
+        printf("  body index maps: %llu published, %llu dropped, compressed %.1fx\n", (unsigned long long)index_stats.pushed,
+            (unsigned long long)index_stats.overruns,
+            m_bodyIndexEncodedBytes > 0 ? (double)m_bodyIndexRawBytes / m_bodyIndexEncodedBytes : 0.0);
+    }
+    if (m_pointCloud)
+    {
+        printf("  point clouds: %llu frames, %.0f points per frame, %llu frames dropped, %llu voxels over the limit\n",
+            (unsigned long long)m_cloudFrames, m_cloudFrames > 0 ? (double)m_cloudPoints / m_cloudFrames : 0.0,
+            (unsigned long long)m_cloudRing.GetStats().overruns, (unsigned long long)m_pointCloud->GetDroppedVoxels());
+    }
+    if (m_config.timestamp_source != TIMESTAMP_SOURCE_POP && m_source.playback == NULL)
+    {
+        double offset, slope;
+        uint64_t observations;
+        m_clockModel->GetFit(&offset, &slope, &observations);
+        printf("  clock model: offset %.6f s, drift %.3f ppm over %llu observations\n", offset, (slope - 1.0) * 1e6,
+            (unsigned long long)observations);
+    }
+}
+
+void SkeletonPipeline::Fail()
+{
+    m_failed = true;
+    m_stop = true;
+}
+
+// Enqueues one capture. Returns false on a hard failure; *accepted tells whether the tracker took it.
+bool SkeletonPipeline::FeedTracker(k4a_capture_t sensor_capture, int32_t timeout_in_ms, bool* accepted)
+{
+    k4a_wait_result_t queue_capture_result = k4abt_tracker_enqueue_capture(m_tracker, sensor_capture, timeout_in_ms);
+    *accepted = queue_capture_result == K4A_WAIT_RESULT_SUCCEEDED;
+    if (queue_capture_result == K4A_WAIT_RESULT_FAILED)
+    {
+        // The tracker thread shuts the tracker down when it fails, which ends up here as well
+        if (!m_stop)
+        {
+            printf("%s: failed to queue capture for processing.\n", m_sourceId.c_str());
+            Fail();
+        }
+        return false;
+    }
+    return true;
+}
+
+void SkeletonPipeline::CaptureLoop()
+{
+    // Captures fetched from the device but not yet accepted by the tracker, oldest first
+    const size_t max_pending = m_config.overload_policy == OVERLOAD_POLICY_KEEP_LATEST ? 1 : std::max<size_t>(m_config.capture_queue_depth, 1);
+    std::vector<PendingCapture> pending;
+    pending.reserve(max_pending);
+
+    int capture_count = 0;
+    bool input_done = false;
+    while (!m_stop && !(input_done && pending.empty()))
+    {
+        // Fetch the next capture. Block only while nothing is waiting for the tracker, and under
+        // the block policy stop fetching altogether while the pending captures fill the backlog.
+        bool can_fetch = !input_done && (m_config.overload_policy != OVERLOAD_POLICY_BLOCK || pending.size() < max_pending);
+        if (can_fetch)
+        {
+            k4a_capture_t sensor_capture;
+            capture_result_t get_capture_result = GetNextCapture(m_source, pending.empty() ? CAPTURE_TIMEOUT_MS : 0, &sensor_capture);
+            if (get_capture_result == CAPTURE_RESULT_FAILED)
+            {
+                printf("%s: get depth capture returned error: %d\n", m_sourceId.c_str(), get_capture_result);
+                Fail();
+                break;
+            }
+            if (get_capture_result == CAPTURE_RESULT_END_OF_FILE)
+            {
+                if (!m_config.quiet)
+                {
+                    printf("%s: end of recording, draining the tracker...\n", m_sourceId.c_str());
+                }
+                input_done = true;
+            }
+            if (get_capture_result == CAPTURE_RESULT_SUCCEEDED)
+            {
+                // Every fresh capture is a (capture time, arrival time) observation for the clock model.
+                // A recording's captures arrive as fast as they are read, so they leave the model alone
+                // and its timestamps stay on the recording's own clock.
+                double arrival = lsl_local_clock();
+                double source_time;
+                if (m_config.timestamp_source != TIMESTAMP_SOURCE_POP && m_source.playback == NULL &&
+                    GetCaptureTimestamp(sensor_capture, m_config.timestamp_source, &source_time))
+                {
+                    m_clockModel->AddObservation(source_time, arrival);
+                }
+
+                if (pending.size() == max_pending)
+                {
+                    if (m_config.overload_policy == OVERLOAD_POLICY_DROP_NEWEST)
+                    {
+                        k4a_capture_release(sensor_capture);
+                        sensor_capture = NULL;
+                    }
+                    else
+                    {
+                        k4a_capture_release(pending.front().capture);
+                        pending.erase(pending.begin());
+                    }
+                    m_droppedCaptures[m_config.overload_policy]++;
+                }
+                if (sensor_capture != NULL)
+                {
+                    pending.push_back({ sensor_capture, arrival, GetCaptureDeviceTimestampUsec(sensor_capture) });
+                }
+
+                m_capturedFrames++;
+                if (m_config.max_captures > 0 && ++capture_count >= m_config.max_captures)
+                {
+                    input_done = true;
+                }
+            }
+        }
+
+        // End of session: stop fetching, hand over what is pending, then let the tracker drain
+        if (!input_done && (IsStopRequested() ||
+            (m_config.max_duration_s > 0 && lsl_local_clock() - m_sessionStart >= m_config.max_duration_s)))
+        {
+            printf("%s: stopping capture, draining the tracker...\n", m_sourceId.c_str());
+            input_done = true;
+        }
+
+        // Hand the oldest pending capture to the tracker. The short timeout paces this loop while
+        // the tracker's queue is full without holding back the next device capture for long.
+        if (!pending.empty())
+        {
+            bool accepted = false;
+            if (!FeedTracker(pending.front().capture, FEED_TIMEOUT_MS, &accepted))
+            {
+                break;
+            }
+            if (accepted)
+            {
+                double now = lsl_local_clock();
+                m_latency[PIPELINE_STAGE_BACKLOG].Record(now - pending.front().arrival);
+                AcceptedCapture* entry = m_acceptedRing.BeginPush();
+                if (entry != NULL)
+                {
+                    entry->device_usec = pending.front().device_usec;
+                    entry->accepted = now;
+                    m_acceptedRing.CommitPush();
+                }
+
+                k4a_capture_release(pending.front().capture); // Release sensor capture after queuing
+                pending.erase(pending.begin());
+            }
+        }
+    }
+
+    for (const PendingCapture& entry : pending)
+    {
+        k4a_capture_release(entry.capture);
+    }
+
+    // No more input. The tracker keeps returning queued results until it is empty, then pop fails.
+    m_captureDone = true;
+    k4abt_tracker_shutdown(m_tracker);
+}
+
+// Capture time of the body frame on the LSL clock
+double SkeletonPipeline::GetFrameTimestamp(k4abt_frame_t body_frame) const
+{
+    switch (m_config.timestamp_source)
+    {
+    case TIMESTAMP_SOURCE_DEVICE:
+        return m_clockModel->ToLslTime(k4abt_frame_get_device_timestamp_usec(body_frame) * 1e-6);
+    case TIMESTAMP_SOURCE_SYSTEM:
+        return m_clockModel->ToLslTime(k4abt_frame_get_system_timestamp_nsec(body_frame) * 1e-9);
+    default:
+        return lsl_local_clock();
+    }
+}
+
+void SkeletonPipeline::TrackerLoop()
+{
+    while (true)
+    {
+        k4abt_frame_t body_frame = NULL;
+        k4a_wait_result_t pop_frame_result = k4abt_tracker_pop_result(m_tracker, &body_frame, POP_TIMEOUT_MS);
+        if (pop_frame_result == K4A_WAIT_RESULT_TIMEOUT)
+        {
+            // Nothing tracked yet; look again unless the pipeline is shutting down after a failure
+            if (m_failed)
+            {
+                break;
+            }
+            continue;
+        }
+        if (pop_frame_result != K4A_WAIT_RESULT_SUCCEEDED)
+        {
+            if (!m_captureDone)
+            {
+                printf("%s: pop body frame result failed!\n", m_sourceId.c_str());
+                Fail();
+                k4abt_tracker_shutdown(m_tracker); // Unblocks the capture thread
+            }
+            break;
+        }
+
+        double popped = lsl_local_clock();
+        m_trackedFrames++;
+
+        // Match the frame to its accepted capture; results come back in the order captures went in
+        uint64_t frame_usec = k4abt_frame_get_device_timestamp_usec(body_frame);
+        const AcceptedCapture* accepted = m_acceptedRing.Front();
+        while (accepted != NULL && accepted->device_usec < frame_usec)
+        {
+            m_acceptedRing.Pop();
+            accepted = m_acceptedRing.Front();
+        }
+        if (accepted != NULL && accepted->device_usec == frame_usec)
+        {
+            m_latency[PIPELINE_STAGE_TRACKER].Record(popped - accepted->accepted);
+            m_acceptedRing.Pop();
+        }
+
+        // Slots are assigned even if the record is dropped below, so they stay sticky
+        size_t num_bodies = std::min<size_t>(k4abt_frame_get_num_bodies(body_frame), MAX_FRAME_BODIES);
+        uint32_t body_ids[MAX_FRAME_BODIES];
+        int slot_of_body[MAX_FRAME_BODIES];
+        for (size_t i = 0; i < num_bodies; i++)
+        {
+            body_ids[i] = k4abt_frame_get_body_id(body_frame, (uint32_t)i);
+            k4abt_frame_get_body_skeleton(body_frame, (uint32_t)i, &m_frameSkeletons[i]);
+        }
+        if (m_primarySelector.IsEnabled())
+        {
+            // Only the primary body gets the slot; bystanders are ignored rather than counted as left out
+            int primary = m_primarySelector.Select(body_ids, m_frameSkeletons.data(), num_bodies);
+            std::fill(slot_of_body, slot_of_body + num_bodies, -1);
+            if (primary >= 0)
+            {
+                m_bodySlots.Assign(&body_ids[primary], 1, &slot_of_body[primary]);
+            }
+            else
+            {
+                m_bodySlots.Assign(body_ids, 0, slot_of_body); // Frees the slot
+            }
+        }
+        else
+        {
+            m_unslottedBodies += m_bodySlots.Assign(body_ids, num_bodies, slot_of_body);
+        }
+
+        // Pack straight into the ring. If the publisher has fallen behind the frame is dropped
+        // (and counted as an overrun) rather than blocking the tracker, unless nothing may be lost.
+        double timestamp = GetFrameTimestamp(body_frame);
+        while (m_config.lossless && !m_publishRing.HasRoom() && !m_failed)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        SkeletonRecord* record = m_publishRing.BeginPush();
+        if (record != NULL)
+        {
+            record->timestamp = timestamp;
+            record->device_usec = frame_usec;
+            record->popped = popped;
+            for (size_t i = 0; i < num_bodies; i++)
+            {
+                if (slot_of_body[i] >= 0)
+                {
+                    float* joints = record->joints + slot_of_body[i] * g_skeletonChannelCount;
+                    PackSkeleton(m_frameSkeletons[i], joints);
+                    if (m_config.min_confidence > K4ABT_JOINT_CONFIDENCE_NONE)
+                    {
+                        GateByConfidence(m_frameSkeletons[i], m_config.min_confidence, joints);
+                    }
+                    PackConfidence(m_frameSkeletons[i], record->confidence + slot_of_body[i] * K4ABT_JOINT_COUNT);
+                }
+            }
+            for (int slot = 0; slot < m_bodySlots.GetSlotCount(); slot++)
+            {
+                record->body_ids[slot] = m_bodySlots.GetBodyId(slot);
+                if (record->body_ids[slot] == K4ABT_INVALID_BODY_ID)
+                {
+                    // Nobody in this slot: publish NaN rather than stale values from the last lap of the ring
+                    float* joints = record->joints + slot * g_skeletonChannelCount;
+                    std::fill(joints, joints + g_skeletonChannelCount, std::numeric_limits<float>::quiet_NaN());
+                    std::fill(record->confidence + slot * K4ABT_JOINT_COUNT, record->confidence + (slot + 1) * K4ABT_JOINT_COUNT,
+                        (uint8_t)K4ABT_JOINT_CONFIDENCE_NONE);
+                }
+            }
+            if (m_smoother)
+            {
+                for (int slot = 0; slot < m_bodySlots.GetSlotCount(); slot++)
+                {
+                    float* smoothed = record->smoothed + slot * g_skeletonChannelCount;
+                    if (record->body_ids[slot] != K4ABT_INVALID_BODY_ID)
+                    {
+                        m_smoother->Apply(slot, record->body_ids[slot], record->joints + slot * g_skeletonChannelCount, frame_usec, smoothed);
+                    }
+                    else
+                    {
+                        m_smoother->Clear(slot, smoothed);
+                    }
+                }
+            }
+            if (m_frameSets != NULL)
+            {
+                m_frameSets->Add(m_frameSetDevice, *record, m_bodySlots.GetSlotCount());
+            }
+            m_publishRing.CommitPush();
+        }
+        if (m_bodyIndexOutlet != NULL)
+        {
+            EncodeBodyIndexMap(body_frame, timestamp, slot_of_body, num_bodies);
+        }
+        if (m_pointCloud)
+        {
+            // Dropped rather than waited for if the point cloud thread is behind
+            CloudFrame* cloud_frame = m_cloudRing.BeginPush();
+            if (cloud_frame != NULL)
+            {
+                k4abt_frame_reference(body_frame);
+                cloud_frame->body_frame = body_frame;
+                cloud_frame->timestamp = timestamp;
+                m_cloudRing.CommitPush();
+            }
+        }
+        k4abt_frame_release(body_frame); // Release body frame after packing
+    }
+
+    m_trackerDone = true;
+}
+
+// Encodes the frame's body index map into the next ring slot, dropping it if the publisher is behind.
+// Pixels carry the body's skeleton slot rather than its index in the frame, so they match the skeleton stream.
+void SkeletonPipeline::EncodeBodyIndexMap(k4abt_frame_t body_frame, double timestamp, const int* slot_of_body, size_t num_bodies)
+{
+    k4a_image_t body_index_map = k4abt_frame_get_body_index_map(body_frame);
+    if (body_index_map == NULL)
+    {
+        return;
+    }
+
+    const int width = k4a_image_get_width_pixels(body_index_map);
+    const int height = k4a_image_get_height_pixels(body_index_map);
+    BodyIndexRecord* record = NULL;
+    if (width <= m_calibration.depth_camera_calibration.resolution_width &&
+        height <= m_calibration.depth_camera_calibration.resolution_height)
+    {
+        record = m_bodyIndexRing.BeginPush();
+    }
+    if (record != NULL)
+    {
+        uint8_t table[256];
+        std::fill(table, table + 256, (uint8_t)K4ABT_BODY_INDEX_MAP_BACKGROUND);
+        bool identity = true;
+        for (size_t i = 0; i < num_bodies; i++)
+        {
+            if (slot_of_body[i] >= 0)
+            {
+                table[i] = (uint8_t)slot_of_body[i];
+            }
+            identity &= table[i] == i;
+        }
+
+        const uint8_t* map = k4a_image_get_buffer(body_index_map);
+        int stride = k4a_image_get_stride_bytes(body_index_map);
+        if (!identity)
+        {
+            RemapBodyIndexMap(map, width, height, stride, table, m_bodyIndexSlots.data());
+            map = m_bodyIndexSlots.data();
+            stride = width;
+        }
+        record->size = (uint32_t)::EncodeBodyIndexMap(map, width, height, stride, record->data);
+        record->timestamp = timestamp;
+        m_bodyIndexRawBytes += (uint64_t)width * height;
+        m_bodyIndexEncodedBytes += record->size;
+        m_bodyIndexRing.CommitPush();
+    }
+    k4a_image_release(body_index_map);
+}
+
+void SkeletonPipeline::PublishBodyIndexMaps()
+{
+    for (const BodyIndexRecord* record = m_bodyIndexRing.Front(); record != NULL; record = m_bodyIndexRing.Front())
+    {
+        const char* data = reinterpret_cast<const char*>(record->data);
+        lsl_push_sample_buft(m_bodyIndexOutlet, &data, &record->size, record->timestamp);
+        m_bodyIndexRing.Pop();
+    }
+}
+
+void SkeletonPipeline::RecordPublished(double timestamp, double popped, double pushed)
+{
+    m_latency[PIPELINE_STAGE_PUBLISH].Record(pushed - popped);
+    m_latency[PIPELINE_STAGE_END_TO_END].Record(pushed - timestamp);
+    m_publishedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Pushes the collected frames as one chunk, each with its own timestamp.
+void SkeletonPipeline::FlushChunk()
+{
+    if (m_chunkFrames > 0)
+    {
+        if (m_outlet != NULL)
+        {
+            lsl_push_chunk_ftp(m_outlet, m_chunkData.data(), (unsigned long)(m_chunkFrames * m_channelCount), m_chunkTimestamps.data());
+        }
+        if (m_fileWriter != NULL)
+        {
+            m_fileWriter->Write(m_chunkData.data(), m_chunkTimestamps.data(), m_chunkFrames);
+        }
+        if (m_confidenceOutlet != NULL)
+        {
+            lsl_push_chunk_ctp(m_confidenceOutlet, reinterpret_cast<const char*>(m_chunkConfidence.data()),
+                (unsigned long)(m_chunkFrames * m_confidenceCount), m_chunkTimestamps.data());
+        }
+        double pushed = lsl_local_clock();
+        for (size_t i = 0; i < m_chunkFrames; i++)
+        {
+            RecordPublished(m_chunkTimestamps[i], m_chunkPopped[i], pushed);
+        }
+        m_chunkFrames = 0;
+    }
+}
+
+// The joints an outlet publishes: smoothed if it was selected for smoothing, raw otherwise
+const float* SkeletonPipeline::GetJoints(const SkeletonRecord& record, smoothed_outlet_t outlet) const
+{
+    return (m_config.smoothed_outlets & (1u << outlet)) != 0 ? record.smoothed : record.joints;
+}
+
+// Pushes every occupied slot on its own outlet. The outlets already exist, so a body
+// arriving costs no more than one that has been there all along.
+void SkeletonPipeline::PushBodyOutlets(const SkeletonRecord& record)
+{
+    for (int slot = 0; slot < m_bodyOutlets->GetSlotCount(); slot++)
+    {
+        if (record.body_ids[slot] != K4ABT_INVALID_BODY_ID)
+        {
+            const float* joints = GetJoints(record, SMOOTHED_OUTLET_BODIES) + slot * g_skeletonChannelCount;
+            if (m_bodyOutlets->Push(slot, record.body_ids[slot], joints, record.timestamp))
+            {
+                printf("%s: body %u publishes on Azure-Kinect-Body%d\n", m_sourceId.c_str(), record.body_ids[slot], slot + 1);
+            }
+        }
+    }
+}
+
+// Derives velocities and accelerations from the packed joints; one sample per frame, never chunked
+void SkeletonPipeline::PushKinematics(const SkeletonRecord& record)
+{
+    for (int slot = 0; slot < m_bodySlots.GetSlotCount(); slot++)
+    {
+        float* out = m_kinematicsData.data() + slot * KINEMATICS_CHANNEL_COUNT;
+        if (record.body_ids[slot] != K4ABT_INVALID_BODY_ID)
+        {
+            m_kinematics->Update(slot, record.body_ids[slot], GetJoints(record, SMOOTHED_OUTLET_KINEMATICS) + slot * g_skeletonChannelCount,
+                record.device_usec, out);
+        }
+        else
+        {
+            m_kinematics->Clear(slot, out);
+        }
+    }
+    lsl_push_sample_ft(m_kinematicsOutlet, m_kinematicsData.data(), record.timestamp);
+}
+
+// Bone directions and joint angles, computed once per body for both streams
+void SkeletonPipeline::PushBoneGeometry(const SkeletonRecord& record)
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    BoneVectors bones;
+    for (int slot = 0; slot < m_bodySlots.GetSlotCount(); slot++)
+    {
+        float* angles = m_angleOutlet != NULL ? m_angleData.data() + slot * JOINT_ANGLE_COUNT : NULL;
+        float* directions = m_boneOutlet != NULL ? m_boneData.data() + slot * BONE_VECTOR_CHANNEL_COUNT : NULL;
+        if (record.body_ids[slot] == K4ABT_INVALID_BODY_ID)
+        {
+            if (angles != NULL)
+            {
+                std::fill(angles, angles + JOINT_ANGLE_COUNT, nan);
+            }
+            if (directions != NULL)
+            {
+                std::fill(directions, directions + BONE_VECTOR_CHANNEL_COUNT, nan);
+            }
+            continue;
+        }
+
+        ComputeBoneVectors(GetJoints(record, SMOOTHED_OUTLET_GEOMETRY) + slot * g_skeletonChannelCount, &bones);
+        if (angles != NULL)
+        {
+            ComputeJointAngles(bones, angles);
+        }
+        if (directions != NULL)
+        {
+            for (int bone = 0; bone < BONE_COUNT; bone++)
+            {
+                directions[bone * 3 + 0] = bones.x[bone];
+                directions[bone * 3 + 1] = bones.y[bone];
+                directions[bone * 3 + 2] = bones.z[bone];
+            }
+        }
+    }
+
+    if (m_angleOutlet != NULL)
+    {
+        lsl_push_sample_ft(m_angleOutlet, m_angleData.data(), record.timestamp);
+    }
+    if (m_boneOutlet != NULL)
+    {
+        lsl_push_sample_ft(m_boneOutlet, m_boneData.data(), record.timestamp);
+    }
+}
+
+// Skeletons rebuilt with each body's estimated bone lengths; one sample per frame, never chunked
+void SkeletonPipeline::PushConstrained(const SkeletonRecord& record)
+{
+    for (int slot = 0; slot < m_bodySlots.GetSlotCount(); slot++)
+    {
+        float* out = m_constrainedData.data() + slot * g_skeletonChannelCount;
+        if (record.body_ids[slot] != K4ABT_INVALID_BODY_ID)
+        {
+            m_lengthFilter->Apply(slot, record.body_ids[slot], GetJoints(record, SMOOTHED_OUTLET_CONSTRAINED) + slot * g_skeletonChannelCount,
+                record.confidence + slot * K4ABT_JOINT_COUNT, out);
+        }
+        else
+        {
+            m_lengthFilter->Clear(slot, out);
+        }
+    }
+    lsl_push_sample_ft(m_constrainedOutlet, m_constrainedData.data(), record.timestamp);
+}
+
+void SkeletonPipeline::PublishLoop()
+{
+    const bool chunked = m_chunkCapacity > 1;
+    while (true)
+    {
+        if (m_bodyIndexOutlet != NULL)
+        {
+            PublishBodyIndexMaps();
+        }
+
+        const SkeletonRecord* record = m_publishRing.Front();
+        if (record != NULL)
+        {
+            if (!chunked)
+            {
+                if (m_outlet != NULL)
+                {
+                    lsl_push_sample_ft(m_outlet, GetJoints(*record, SMOOTHED_OUTLET_SKELETON), record->timestamp);
+                }
+                if (m_fileWriter != NULL)
+                {
+                    m_fileWriter->Write(GetJoints(*record, SMOOTHED_OUTLET_SKELETON), &record->timestamp, 1);
+                }
+                if (m_confidenceOutlet != NULL)
+                {
+                    lsl_push_sample_ct(m_confidenceOutlet, reinterpret_cast<const char*>(record->confidence), record->timestamp);
+                }
+                RecordPublished(record->timestamp, record->popped, lsl_local_clock());
+            }
+            else
+            {
+                if (m_chunkFrames == 0)
+                {
+                    m_chunkStarted = lsl_local_clock();
+                }
+                const float* joints = GetJoints(*record, SMOOTHED_OUTLET_SKELETON);
+                std::copy(joints, joints + m_channelCount, m_chunkData.begin() + m_chunkFrames * m_channelCount);
+                std::copy(record->confidence, record->confidence + m_confidenceCount, m_chunkConfidence.begin() + m_chunkFrames * m_confidenceCount);
+                m_chunkTimestamps[m_chunkFrames] = record->timestamp;
+                m_chunkPopped[m_chunkFrames++] = record->popped;
+            }
+            if (m_bodyOutlets != NULL && m_bodyOutlets->GetSlotCount() > 0)
+            {
+                PushBodyOutlets(*record);
+            }
+            if (m_kinematics)
+            {
+                PushKinematics(*record);
+            }
+            if (m_angleOutlet != NULL || m_boneOutlet != NULL)
+            {
+                PushBoneGeometry(*record);
+            }
+            if (m_lengthFilter)
+            {
+                PushConstrained(*record);
+            }
+            m_publishRing.Pop();
+
+            if (m_chunkFrames == m_chunkCapacity)
+            {
+                FlushChunk();
+            }
+            continue;
+        }
+
+        if (m_chunkFrames > 0 && m_config.chunk_ms > 0 && (lsl_local_clock() - m_chunkStarted) * 1000 >= m_config.chunk_ms)
+        {
+            FlushChunk();
+        }
+
+        if (m_trackerDone)
+        {
+            // The tracker may have committed its last record after the empty check above
+            if (m_publishRing.Front() == NULL)
+            {
+                FlushChunk();
+                if (m_bodyIndexOutlet != NULL)
+                {
+                    PublishBodyIndexMaps();
+                }
+                m_publishDone = true;
+                break;
+            }
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+// Extracts and publishes the point clouds of the frames the tracker thread hands over, one chunk per frame
+void SkeletonPipeline::PointCloudLoop()
+{
+    if (!m_pointCloud)
+    {
+        return;
+    }
+
+    while (true)
+    {
+        const CloudFrame* cloud_frame = m_cloudRing.Front();
+        if (cloud_frame == NULL)
+        {
+            // The tracker may have committed its last frame after the empty check above
+            if (m_trackerDone && m_cloudRing.Front() == NULL)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        k4abt_frame_t body_frame = cloud_frame->body_frame;
+        k4a_capture_t capture = k4abt_frame_get_capture(body_frame);
+        k4a_image_t depth_image = capture != NULL ? k4a_capture_get_depth_image(capture) : NULL;
+        k4a_image_t body_index_map = k4abt_frame_get_body_index_map(body_frame);
+        if (depth_image != NULL && body_index_map != NULL &&
+            k4a_image_get_width_pixels(depth_image) == m_pointCloud->GetWidth() &&
+            k4a_image_get_height_pixels(depth_image) == m_pointCloud->GetHeight() &&
+            k4a_image_get_width_pixels(body_index_map) == m_pointCloud->GetWidth() &&
+            k4a_image_get_height_pixels(body_index_map) == m_pointCloud->GetHeight())
+        {
+            size_t num_bodies = std::min<size_t>(k4abt_frame_get_num_bodies(body_frame), MAX_FRAME_BODIES);
+            uint32_t body_ids[MAX_FRAME_BODIES];
+            for (size_t i = 0; i < num_bodies; i++)
+            {
+                body_ids[i] = k4abt_frame_get_body_id(body_frame, (uint32_t)i);
+            }
+
+            size_t points = m_pointCloud->Extract(reinterpret_cast<const uint16_t*>(k4a_image_get_buffer(depth_image)),
+                k4a_image_get_stride_bytes(depth_image), k4a_image_get_buffer(body_index_map),
+                k4a_image_get_stride_bytes(body_index_map), body_ids, num_bodies, m_cloudData.data());
+            if (points > 0)
+            {
+                // Irregular rate, so every point of the chunk carries the frame's timestamp
+                lsl_push_chunk_ft(m_pointCloudOutlet, m_cloudData.data(), (unsigned long)(points * POINT_CLOUD_CHANNEL_COUNT),
+                    cloud_frame->timestamp);
+            }
+            m_cloudFrames++;
+            m_cloudPoints += points;
+        }
+
+        if (body_index_map != NULL)
+        {
+            k4a_image_release(body_index_map);
+        }
+        if (depth_image != NULL)
+        {
+            k4a_image_release(depth_image);
+        }
+        if (capture != NULL)
+        {
+            k4a_capture_release(capture);
+        }
+        k4abt_frame_release(body_frame);
+        m_cloudRing.Pop();
+    }
+}
+
+// Every stats interval, prints (and optionally publishes) what each stage cost since the last report
+void SkeletonPipeline::MetricsLoop()
+{
+    if (m_config.stats_interval_s <= 0)
+    {
+        return;
+    }
+
+    // Snapshots are a few kB each, so keep them off the stack and allocate them once
+    std::vector<LatencySnapshot> previous(PIPELINE_STAGE_COUNT);
+    std::vector<LatencySnapshot> current(PIPELINE_STAGE_COUNT);
+    std::vector<LatencySnapshot> interval_latency(PIPELINE_STAGE_COUNT);
+    PipelineCounts previous_counts = {};
+    double sample[METRICS_CHANNEL_COUNT];
+
+    double last_report = lsl_local_clock();
+    while (!m_publishDone)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        double now = lsl_local_clock();
+        double interval = now - last_report;
+        if (interval < m_config.stats_interval_s)
+        {
+            continue;
+        }
+
+        PipelineCounts counts;
+        counts.published = m_publishedFrames;
+        counts.dropped_captures = 0;
+        for (int policy = 0; policy < OVERLOAD_POLICY_COUNT; policy++)
+        {
+            counts.dropped_captures += m_droppedCaptures[policy];
+        }
+        counts.ring_overruns = m_publishRing.GetStats().overruns;
+
+        PipelineCounts interval_counts;
+        interval_counts.published = counts.published - previous_counts.published;
+        interval_counts.dropped_captures = counts.dropped_captures - previous_counts.dropped_captures;
+        interval_counts.ring_overruns = counts.ring_overruns - previous_counts.ring_overruns;
+
+        for (int stage = 0; stage < PIPELINE_STAGE_COUNT; stage++)
+        {
+            m_latency[stage].Snapshot(&current[stage]);
+            interval_latency[stage] = current[stage];
+            interval_latency[stage].Subtract(previous[stage]);
+            previous[stage] = current[stage];
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(g_reportMutex);
+            PrintPipelineMetrics(m_sourceId.c_str(), interval_latency.data(), interval_counts, interval);
+        }
+
+        double interval_fps = interval_counts.published / interval;
+        m_minIntervalFps = m_reportedIntervals == 0 ? interval_fps : std::min(m_minIntervalFps, interval_fps);
+        m_maxIntervalFps = m_reportedIntervals == 0 ? interval_fps : std::max(m_maxIntervalFps, interval_fps);
+        m_reportedIntervals++;
+        if (m_metricsOutlet != NULL)
+        {
+            double offset, slope;
+            uint64_t observations;
+            m_clockModel->GetFit(&offset, &slope, &observations);
+            FillMetricsSample(interval_latency.data(), interval_counts, interval, (slope - 1.0) * 1e6, sample);
+            lsl_push_sample_d(m_metricsOutlet, sample);
+        }
+
+        previous_counts = counts;
+        last_report = now;
+    }
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <lsl_cpp.h>
+#include <k4a/k4a.h>
+#include <k4abt.h>
+#include "BodyOutletPool.h"
+#include "BodyPointCloud.h"
+#include "BoneGeometry.h"
+#include "BodySlots.h"
+#include "BoneLengthFilter.h"
+#include "BodyTrackingHelpers.h"
+#include "CaptureSource.h"
+#include "ClockSync.h"
+#include "FrameSetCollector.h"
+#include "JointKinematics.h"
+#include "JointSmoothing.h"
+#include "PipelineMetrics.h"
+#include "PrimarySelector.h"
+#include "SkeletonFileWriter.h"
+#include "SpscRing.h"
+
+// One sample as it travels from the tracker thread to the publisher: a packed skeleton per body
+// slot, each laid out as documented next to g_jointNames. The joints point into storage the
+// pipeline allocates once for the whole ring.
+struct alignas(CACHE_LINE_SIZE) SkeletonRecord
+{
+    float* joints;
+    float* smoothed; // The joints after JointSmoother, NULL unless some outlet publishes smoothed joints
+    uint8_t* confidence; // K4ABT_JOINT_COUNT levels per body slot, 0 for empty slots
+    double timestamp;
+    uint64_t device_usec; // Device timestamp of the frame, for derivatives that must not depend on the LSL mapping
+    double popped; // lsl_local_clock() when the body frame was popped
+    uint32_t body_ids[MAX_BODY_SLOTS];
+};
+
+// One encoded body index map on its way to the publisher; data points into storage the
+// pipeline allocates once for the whole ring.
+struct BodyIndexRecord
+{
+    uint8_t* data;
+    uint32_t size;
+    double timestamp; // Same timestamp as the skeleton sample of the frame
+};
+
+// A body frame handed to the point cloud thread, which holds its own reference until it is done
+struct CloudFrame
+{
+    k4abt_frame_t body_frame;
+    double timestamp;
+};
+
+// A capture the tracker has accepted, so its result can be matched up for the tracker latency
+struct AcceptedCapture
+{
+    uint64_t device_usec;
+    double accepted;
+};
+
+// What the capture thread does when the tracker cannot accept a new capture in time.
+typedef enum
+{
+    OVERLOAD_POLICY_BLOCK = 0,   // Never drop; stop fetching until the tracker takes the pending captures
+    OVERLOAD_POLICY_DROP_OLDEST, // Discard the oldest pending capture to make room for the new one
+    OVERLOAD_POLICY_DROP_NEWEST, // Discard the new capture while the pending captures wait
+    OVERLOAD_POLICY_KEEP_LATEST, // Keep only the most recent capture pending
+    OVERLOAD_POLICY_COUNT
+} overload_policy_t;
+
+const char* GetOverloadPolicyName(overload_policy_t policy);
+
+struct PipelineConfig
+{
+    int max_captures = 0;              // Stop after this many captures, 0 for no limit
+    int max_duration_s = 0;            // Stop after this many seconds, 0 for no limit
+    int body_slots = 1;                // Bodies per sample, at most MAX_BODY_SLOTS
+    primary_selection_t primary_selection = PRIMARY_SELECTION_OFF; // Publish only the primary body, needs body_slots 1
+    SelectionVolume selection_volume;  // Used by PRIMARY_SELECTION_VOLUME
+    overload_policy_t overload_policy = OVERLOAD_POLICY_BLOCK;
+    size_t capture_queue_depth = 2;    // Captures held back while the tracker's own queue is full
+    size_t publish_ring_capacity = 64; // Packed skeletons waiting for the LSL publisher
+    int chunk_frames = 1;              // Publish in chunks of this many frames, 1 pushes every frame on its own
+    int chunk_ms = 0;                  // Also publish a chunk once its oldest frame is this old, 0 disables
+    timestamp_source_t timestamp_source = TIMESTAMP_SOURCE_DEVICE;
+    int stats_interval_s = 10;         // Print per-stage latencies this often, 0 disables
+    bool metrics_stream = false;       // Also publish them on a low-rate LSL metrics stream
+    bool body_index_stream = false;    // Publish the run-length encoded body index map
+    int point_cloud_voxel_mm = 0;      // Publish per-body point clouds downsampled to this voxel size, 0 disables
+    bool confidence_stream = false;    // Publish joint confidence levels on a uint8 side stream
+    k4abt_joint_confidence_level_t min_confidence = K4ABT_JOINT_CONFIDENCE_NONE; // NaN positions below this level
+    bool kinematics_stream = false;    // Publish joint velocities and accelerations
+    bool angle_stream = false;         // Publish anatomical joint angles
+    bool bone_stream = false;          // Publish bone directions
+    bool constrained_stream = false;   // Publish skeletons rebuilt with bone lengths estimated online
+    uint32_t smoothed_outlets = 0;     // Bit (1 << smoothed_outlet_t) set for every outlet fed smoothed joints
+    SmoothingConfig smoothing;
+    bool lossless = false;             // Never drop a frame: block capture and wait for the publisher, for recordings
+    bool quiet = false;                // Skip the start line and session summary, for callers that report on their own
+};
+
+/**
+ * Runs capture, body tracking and LSL publishing on three threads:
+ *  - the capture thread pulls captures from the device and feeds the tracker's input queue,
+ *  - the tracker thread pops body frames and packs the skeleton,
+ *  - the publisher thread pushes packed skeletons to the outlet.
+ * Because capture no longer waits for inference, the tracker always has captures in flight.
+ * Tracker and publisher share a lock-free ring, so a stall inside LSL never delays popping results.
+ * All SDK calls use finite timeouts; when the tracker falls behind the camera the configured
+ * overload policy decides which captures are dropped, so latency stays bounded.
+ * Samples are stamped with the capture time, mapped onto the LSL clock by the clock model that
+ * the capture thread keeps fitting, so tracker latency does not end up in the timestamps.
+ * A fourth thread periodically reports per-stage latency histograms.
+ * Each sample carries a fixed number of body slots; bodies keep their slot while they are tracked
+ * and empty slots are NaN. Optionally each occupied slot is also pushed on its own outlet.
+ * With a primary selection only the selected body is published, in the single slot.
+ * The tracker thread can also smooth every skeleton; each outlet then publishes either the raw or
+ * the smoothed joints.
+ * With several devices the tracked frames can also go to a FrameSetCollector, which aligns them
+ * with the other devices' frames.
+ * The body index map can be published run-length encoded, with the skeleton's timestamps, and a
+ * fifth thread can turn it into per-body point clouds.
+ * The captures can also come from a recording, which is read as fast as the tracker takes it; with
+ * lossless set every frame of it is published, and a SkeletonFileWriter can take the place of LSL.
+ */
+class SkeletonPipeline
+{
+public:
+    // body_outlets may be NULL, or a pool with one outlet per body slot that the publisher feeds as well.
+    // outlet may be NULL if a file writer is attached; the side streams are then left out.
+    SkeletonPipeline(const CaptureSource& source, k4abt_tracker_t tracker, const k4a_calibration_t& calibration, lsl_outlet outlet,
+        ClockModel* clock_model, BodyOutletPool* body_outlets, const PipelineConfig& config);
+    ~SkeletonPipeline();
+
+    // Starts the threads and blocks until they have all finished, which happens when a stop signal
+    // arrives, a configured limit is reached or a stage fails. On the way out capture stops, the
+    // tracker is shut down and drained, every remaining result is published and a session summary
+    // is printed. Returns 0 on a clean finish, -1 if any stage failed.
+    int Run();
+
+    // Hands every tracked frame to the collector as well, as this device's frames. Call before Run.
+    void AttachFrameSets(FrameSetCollector* collector, int device);
+
+    // Writes every published frame to the file as well; without an outlet the pipeline takes the
+    // writer's source_id. Call before Run.
+    void AttachFileWriter(SkeletonFileWriter* writer);
+
+    SpscRingStats GetPublishRingStats() const { return m_publishRing.GetStats(); }
+    uint64_t GetDroppedCaptures(overload_policy_t policy) const { return m_droppedCaptures[policy]; }
+    uint64_t GetPublishedFrames() const { return m_publishedFrames; }
+
+private:
+    void CaptureLoop();
+    void TrackerLoop();
+    void PublishLoop();
+    void MetricsLoop();
+    void PointCloudLoop();
+    void RecordPublished(double timestamp, double popped, double pushed);
+    bool FeedTracker(k4a_capture_t sensor_capture, int32_t timeout_in_ms, bool* accepted);
+    double GetFrameTimestamp(k4abt_frame_t body_frame) const;
+    void FlushChunk();
+    void PushBodyOutlets(const SkeletonRecord& record);
+    void PushKinematics(const SkeletonRecord& record);
+    void PushBoneGeometry(const SkeletonRecord& record);
+    void PushConstrained(const SkeletonRecord& record);
+    const float* GetJoints(const SkeletonRecord& record, smoothed_outlet_t outlet) const;
+    void EncodeBodyIndexMap(k4abt_frame_t body_frame, double timestamp, const int* slot_of_body, size_t num_bodies);
+    void PublishBodyIndexMaps();
+    void PrintSessionSummary(double duration) const;
+    void Fail();
+
+    CaptureSource m_source;
+    k4abt_tracker_t m_tracker;
+    k4a_calibration_t m_calibration;
+    lsl_outlet m_outlet;
+    ClockModel* m_clockModel;
+    BodyOutletPool* m_bodyOutlets;
+    PipelineConfig m_config;
+    std::string m_sourceId; // The skeleton stream's, which prefixes every side stream's
+    FrameSetCollector* m_frameSets = NULL;
+    int m_frameSetDevice = 0;
+    SkeletonFileWriter* m_fileWriter = NULL;
+
+    size_t m_channelCount; // body_slots * g_skeletonChannelCount
+    BodySlotMap m_bodySlots;
+    size_t m_confidenceCount; // body_slots * K4ABT_JOINT_COUNT
+    PrimarySelector m_primarySelector;
+    std::vector<k4abt_skeleton_t> m_frameSkeletons; // Skeletons of the frame being packed, MAX_FRAME_BODIES
+    std::vector<float> m_recordJoints; // Joint storage behind every publish ring slot
+    std::vector<float> m_recordSmoothed;
+    std::unique_ptr<JointSmoother> m_smoother;
+    std::vector<uint8_t> m_recordConfidence;
+    SpscRing<SkeletonRecord> m_publishRing;
+    SpscRing<AcceptedCapture> m_acceptedRing;
+
+    // Frames collected by the publisher for the next chunk; preallocated for the largest chunk
+    size_t m_chunkCapacity;
+    size_t m_chunkFrames = 0;
+    double m_chunkStarted = 0;
+    std::vector<float> m_chunkData;
+    std::vector<double> m_chunkTimestamps;
+    std::vector<double> m_chunkPopped;
+    std::vector<uint8_t> m_chunkConfidence;
+    lsl_outlet m_confidenceOutlet = NULL;
+
+    // Streams derived from the packed skeletons on the publisher thread
+    std::unique_ptr<JointKinematics> m_kinematics;
+    std::vector<float> m_kinematicsData;
+    lsl_outlet m_kinematicsOutlet = NULL;
+    std::vector<float> m_angleData;
+    std::vector<float> m_boneData;
+    lsl_outlet m_angleOutlet = NULL;
+    lsl_outlet m_boneOutlet = NULL;
+    std::unique_ptr<BoneLengthFilter> m_lengthFilter;
+    std::vector<float> m_constrainedData;
+    lsl_outlet m_constrainedOutlet = NULL;
+
+    LatencyHistogram m_latency[PIPELINE_STAGE_COUNT];
+    double m_sessionStart = 0;
+    std::atomic<uint64_t> m_capturedFrames{ 0 };
+    std::atomic<uint64_t> m_trackedFrames{ 0 };
+    std::atomic<uint64_t> m_publishedFrames{ 0 };
+    uint64_t m_unslottedBodies = 0; // Written by the tracker thread, read after it has finished
+    double m_minIntervalFps = 0; // Written by the metrics thread, read after it has finished
+    double m_maxIntervalFps = 0;
+    int m_reportedIntervals = 0;
+    lsl_outlet m_metricsOutlet = NULL;
+
+    // Optional body index map stream, fed through its own ring so a slow push never holds up skeletons
+    lsl_outlet m_bodyIndexOutlet = NULL;
+    std::vector<uint8_t> m_bodyIndexStorage;
+    SpscRing<BodyIndexRecord> m_bodyIndexRing;
+    std::vector<uint8_t> m_bodyIndexSlots; // The map remapped to slots, when that differs from the tracker's
+    uint64_t m_bodyIndexRawBytes = 0;     // Written by the tracker thread, read after it has finished
+    uint64_t m_bodyIndexEncodedBytes = 0;
+
+    // Optional point clouds, extracted on their own thread so the tracker thread only hands frames over
+    std::unique_ptr<BodyPointCloud> m_pointCloud;
+    lsl_outlet m_pointCloudOutlet = NULL;
+    std::vector<float> m_cloudData;
+    SpscRing<CloudFrame> m_cloudRing;
+    uint64_t m_cloudFrames = 0; // Written by the point cloud thread, read after it has finished
+    uint64_t m_cloudPoints = 0;
+
+    std::atomic<bool> m_stop{ false };
+    std::atomic<bool> m_captureDone{ false };
+    std::atomic<bool> m_trackerDone{ false };
+    std::atomic<bool> m_publishDone{ false };
+    std::atomic<bool> m_failed{ false };
+    std::atomic<uint64_t> m_droppedCaptures[OVERLOAD_POLICY_COUNT] = {};
+};
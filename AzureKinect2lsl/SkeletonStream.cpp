@@ -0,0 +1,142 @@
+#include "SkeletonStream.h"
+
+#include <vector>
+#include "BodyTrackingHelpers.h"
+
+const char* GetChannelFormatName(lsl_channel_format_t channel_format)
+{
+    switch (channel_format)
+    {
+    case cft_float32:  return "float32";
+    case cft_double64: return "double64";
+    default:           return "unsupported";
+    }
+}
+
+// Description shared by every skeleton stream, with one <channel> node per value
+static void AppendSkeletonDescription(lsl_streaminfo info, int body_slots)
+{
+    // Add metadata to the LSL stream
+    /* (for more standard fields, see https://github.com/sccn/xdf/wiki/Meta-Data) */
+    lsl_xml_ptr desc = lsl_get_desc(info);
+    lsl_append_child_value(desc, "manufacturer", "University of Groningen");
+    lsl_append_child_value(desc, "model", "Azure Kinect");
+    lsl_append_child_value(desc, "body_slots", std::to_string(body_slots).c_str());
+
+    // Append one channel per value, in the fixed order the packer writes them
+    lsl_xml_ptr chns = lsl_append_child(desc, "channels");
+    for (int slot = 0; slot < body_slots; slot++)
+    {
+        std::string prefix = body_slots > 1 ? "BODY" + std::to_string(slot + 1) + "_" : "";
+        for (const char* joint_name : g_jointNames)
+        {
+            for (const char* suffix : g_jointChannelSuffixes)
+            {
+                lsl_xml_ptr channel = lsl_append_child(chns, "channel");
+                lsl_append_child_value(channel, "name", (prefix + joint_name + suffix).c_str());
+                lsl_append_child_value(channel, "unit", "mm"); // Units in millimeters
+            }
+        }
+    }
+}
+
+lsl_streaminfo CreateSkeletonStreamInfo(const std::string& source_id, double nominal_srate, int body_slots, const StreamConfig& config)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect", "MoCap", body_slots * g_skeletonChannelCount, nominal_srate,
+        config.channel_format, source_id.c_str());
+    AppendSkeletonDescription(info, body_slots);
+    return info;
+}
+
+lsl_streaminfo CreateBodyStreamInfo(const std::string& source_id, double nominal_srate, int slot, const StreamConfig& config)
+{
+    std::string name = "Azure-Kinect-Body" + std::to_string(slot + 1);
+    lsl_streaminfo info = lsl_create_streaminfo(name.c_str(), "MoCap", g_skeletonChannelCount, nominal_srate,
+        config.channel_format, (source_id + "-body" + std::to_string(slot + 1)).c_str());
+    AppendSkeletonDescription(info, 1);
+    return info;
+}
+
+lsl_streaminfo CreateConstrainedStreamInfo(const std::string& source_id, double nominal_srate, int body_slots)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-Constrained", "MoCap", body_slots * g_skeletonChannelCount,
+        nominal_srate, cft_float32, (source_id + "-constrained").c_str());
+    AppendSkeletonDescription(info, body_slots);
+    lsl_append_child_value(lsl_get_desc(info), "filter", "bone lengths estimated online and held constant");
+    return info;
+}
+
+lsl_streaminfo CreateFusedStreamInfo(const std::string& source_id, double nominal_srate, int body_slots)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-Fused", "MoCap", body_slots * g_skeletonChannelCount,
+        nominal_srate, cft_float32, (source_id + "-fused").c_str());
+    AppendSkeletonDescription(info, body_slots);
+    return info;
+}
+
+lsl_streaminfo CreateConfidenceStreamInfo(const std::string& source_id, double nominal_srate, int body_slots)
+{
+    lsl_streaminfo info = lsl_create_streaminfo("Azure-Kinect-Confidence", "MoCap", body_slots * K4ABT_JOINT_COUNT, nominal_srate,
+        cft_int8, (source_id + "-confidence").c_str());
+
+    lsl_xml_ptr desc = lsl_get_desc(info);
+    lsl_append_child_value(desc, "manufacturer", "University of Groningen");
+    lsl_append_child_value(desc, "model", "Azure Kinect");
+    lsl_append_child_value(desc, "body_slots", std::to_string(body_slots).c_str());
+    lsl_append_child_value(desc, "levels", "0 none (out of range), 1 low (predicted), 2 medium (measured), 3 high");
+
+    lsl_xml_ptr chns = lsl_append_child(desc, "channels");
+    for (int slot = 0; slot < body_slots; slot++)
+    {
+        std::string prefix = body_slots > 1 ? "BODY" + std::to_string(slot + 1) + "_" : "";
+        for (const char* joint_name : g_jointNames)
+        {
+            lsl_xml_ptr channel = lsl_append_child(chns, "channel");
+            lsl_append_child_value(channel, "name", (prefix + joint_name + "_conf").c_str());
+            lsl_append_child_value(channel, "unit", "level");
+        }
+    }
+    return info;
+}
+
+const char* GetConfidenceLevelName(k4abt_joint_confidence_level_t level)
+{
+    switch (level)
+    {
+    case K4ABT_JOINT_CONFIDENCE_NONE:   return "none";
+    case K4ABT_JOINT_CONFIDENCE_LOW:    return "low";
+    case K4ABT_JOINT_CONFIDENCE_MEDIUM: return "medium";
+    case K4ABT_JOINT_CONFIDENCE_HIGH:   return "high";
+    default:                            return "unknown";
+    }
+}
+
+std::string GetDeviceSerial(k4a_device_t device)
+{
+    size_t serial_size = 0;
+    if (k4a_device_get_serialnum(device, NULL, &serial_size) != K4A_BUFFER_RESULT_TOO_SMALL)
+    {
+        return std::string();
+    }
+    std::vector<char> serial(serial_size);
+    if (k4a_device_get_serialnum(device, serial.data(), &serial_size) != K4A_BUFFER_RESULT_SUCCEEDED)
+    {
+        return std::string();
+    }
+    return std::string(serial.data());
+}
+
+std::string GetDeviceSourceId(k4a_device_t device, uint32_t device_index)
+{
+    std::string serial = GetDeviceSerial(device);
+    if (!serial.empty())
+    {
+        return serial;
+    }
+    return device_index == 0 ? "325wqer4354" : "325wqer4354-" + std::to_string(device_index);
+}
+
+lsl_outlet CreateSkeletonOutlet(lsl_streaminfo info, const StreamConfig& config)
+{
+    return lsl_create_outlet(info, config.outlet_chunk_size, config.max_buffered);
+}
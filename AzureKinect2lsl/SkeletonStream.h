@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <lsl_cpp.h>
+#include <k4a/k4a.h>
+#include <k4abttypes.h>
+
+// How the skeleton stream is declared to LSL.
+struct StreamConfig
+{
+    lsl_channel_format_t channel_format = cft_float32; // cft_float32 or cft_double64 on the wire
+    int outlet_chunk_size = 0;                         // Samples per network chunk, 0 lets LSL decide
+    int max_buffered = 60;                             // Seconds of data the outlet keeps for slow consumers
+    bool body_outlets = false;                         // Also publish every body slot on an outlet of its own
+};
+
+const char* GetChannelFormatName(lsl_channel_format_t channel_format);
+
+/**
+ * Every stream of a device shares the device's source_id: the skeleton stream uses it as it is and
+ * the other streams append a suffix such as -confidence or -body<slot>.
+ *
+ * Creates the stream info for the skeleton stream: g_skeletonChannelCount channels per body slot in
+ * the layout documented next to g_jointNames, with one <channel> node per value in the description.
+ * With more than one slot the channel names are prefixed with BODY<slot>_, counting from 1.
+ * The packer always produces floats; LSL converts them if double64 is requested.
+ */
+lsl_streaminfo CreateSkeletonStreamInfo(const std::string& source_id, double nominal_srate, int body_slots, const StreamConfig& config);
+
+/**
+ * Creates the stream info for one body slot's own stream, "Azure-Kinect-Body<slot>" counting from 1:
+ * g_skeletonChannelCount channels named as in the single-body skeleton stream, with the source_id
+ * "<source_id>-body<slot>" so recorders can reconnect to the same slot.
+ */
+lsl_streaminfo CreateBodyStreamInfo(const std::string& source_id, double nominal_srate, int slot, const StreamConfig& config);
+
+/**
+ * Creates the stream info for the length-constrained skeletons, "Azure-Kinect-Constrained": the same
+ * channels as the skeleton stream, rebuilt by BoneLengthFilter with constant bone lengths.
+ */
+lsl_streaminfo CreateConstrainedStreamInfo(const std::string& source_id, double nominal_srate, int body_slots);
+
+/**
+ * Creates the stream info for the fused skeletons of several devices, "Azure-Kinect-Fused": the
+ * same channels as the skeleton stream, in the shared world frame. The source_id names the devices.
+ */
+lsl_streaminfo CreateFusedStreamInfo(const std::string& source_id, double nominal_srate, int body_slots);
+
+/**
+ * Creates the stream info for the joint confidence side stream: one int8 channel per joint and body
+ * slot, named like the skeleton's joints with a _conf suffix, holding k4abt_joint_confidence_level_t.
+ */
+lsl_streaminfo CreateConfidenceStreamInfo(const std::string& source_id, double nominal_srate, int body_slots);
+
+const char* GetConfidenceLevelName(k4abt_joint_confidence_level_t level);
+
+// Serial number of the device, used to derive stable source ids. Empty if it cannot be read.
+std::string GetDeviceSerial(k4a_device_t device);
+
+// Source id for the streams of the device at this index: its serial number, so every camera keeps
+// its own ids across restarts and USB ports. Without a readable serial it falls back to the
+// original fixed id, suffixed with the index for any device but the first.
+std::string GetDeviceSourceId(k4a_device_t device, uint32_t device_index);
+
+// Creates an outlet with the configured transmission chunk size and buffer length.
+lsl_outlet CreateSkeletonOutlet(lsl_streaminfo info, const StreamConfig& config);
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_LINE_SIZE 64
+
+struct SpscRingStats
+{
+    size_t capacity;
+    size_t occupancy;      // Records waiting for the consumer right now
+    size_t peak_occupancy; // Highest occupancy seen by the producer
+    uint64_t pushed;
+    uint64_t overruns;     // Pushes rejected because the ring was full
+};
+
+/**
+ * Single-producer/single-consumer ring of preallocated records.
+ * Storage is allocated once in the constructor; after that neither side allocates or locks.
+ * The producer fills a slot in place (BeginPush/CommitPush) and the consumer reads it in place
+ * (Front/Pop), so a record is never copied on the way through. When the ring is full BeginPush
+ * returns NULL and counts an overrun instead of waiting for the consumer.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    // The capacity is rounded up to a power of two so indices can be masked.
+    explicit SpscRing(size_t capacity)
+    {
+        size_t rounded = 1;
+        while (rounded < capacity)
+        {
+            rounded <<= 1;
+        }
+        m_mask = rounded - 1;
+        m_slots.reset(new T[rounded]);
+    }
+
+    // Lets the owner attach preallocated storage to every slot. Call before either side starts.
+    template <typename F>
+    void ForEachSlot(F initialize)
+    {
+        for (size_t i = 0; i <= m_mask; i++)
+        {
+            initialize(m_slots[i]);
+        }
+    }
+
+    // Producer side. Returns the slot to fill, or NULL if the consumer has not caught up.
+    T* BeginPush()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cachedTail > m_mask)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head - m_cachedTail > m_mask)
+            {
+                m_overruns.fetch_add(1, std::memory_order_relaxed);
+                return NULL;
+            }
+        }
+        return &m_slots[head & m_mask];
+    }
+
+    // Producer side. Whether BeginPush would find a free slot, for a producer that waits rather than
+    // drops; nothing is counted.
+    bool HasRoom()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_cachedTail > m_mask)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+        }
+        return head - m_cachedTail <= m_mask;
+    }
+
+    // Producer side. Publishes the slot returned by the last BeginPush.
+    void CommitPush()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed) + 1;
+        m_head.store(head, std::memory_order_release);
+        m_pushed.fetch_add(1, std::memory_order_relaxed);
+
+        // The cached tail is only refreshed when the ring looks full, so it would overstate the
+        // occupancy; read the consumer's current tail instead and keep it for the next BeginPush
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        const size_t occupancy = head - m_cachedTail;
+        if (occupancy > m_peakOccupancy.load(std::memory_order_relaxed))
+        {
+            m_peakOccupancy.store(occupancy, std::memory_order_relaxed);
+        }
+    }
+
+    // Consumer side. Returns the oldest record, or NULL if the ring is empty.
+    const T* Front()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_cachedHead)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail == m_cachedHead)
+            {
+                return NULL;
+            }
+        }
+        return &m_slots[tail & m_mask];
+    }
+
+    // Consumer side. Releases the record returned by Front back to the producer.
+    void Pop()
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Safe to call from any thread; the values are a snapshot.
+    SpscRingStats GetStats() const
+    {
+        SpscRingStats stats;
+        stats.capacity = m_mask + 1;
+        stats.occupancy = m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+        stats.peak_occupancy = m_peakOccupancy.load(std::memory_order_relaxed);
+        stats.pushed = m_pushed.load(std::memory_order_relaxed);
+        stats.overruns = m_overruns.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    std::unique_ptr<T[]> m_slots;
+    size_t m_mask;
+
+    // Written by the producer only
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{ 0 };
+    size_t m_cachedTail = 0;
+    std::atomic<uint64_t> m_pushed{ 0 };
+    std::atomic<uint64_t> m_overruns{ 0 };
+    std::atomic<size_t> m_peakOccupancy{ 0 };
+
+    // Written by the consumer only
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{ 0 };
+    size_t m_cachedHead = 0;
+};
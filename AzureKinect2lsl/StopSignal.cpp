@@ -0,0 +1,30 @@
+#include "StopSignal.h"
+
+#include <atomic>
+#include <signal.h>
+#include <stdlib.h>
+
+static std::atomic<bool> g_stopRequested{ false };
+
+static void OnStopSignal(int signal_number)
+{
+    if (g_stopRequested.exchange(true))
+    {
+        _Exit(128 + signal_number);
+    }
+    signal(signal_number, OnStopSignal); // Some platforms reset the handler after delivery
+}
+
+void InstallStopSignalHandlers()
+{
+    signal(SIGINT, OnStopSignal);
+    signal(SIGTERM, OnStopSignal);
+#ifdef SIGBREAK
+    signal(SIGBREAK, OnStopSignal);
+#endif
+}
+
+bool IsStopRequested()
+{
+    return g_stopRequested.load(std::memory_order_relaxed);
+}
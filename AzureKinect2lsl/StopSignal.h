@@ -0,0 +1,6 @@
+#pragma once
+
+// Routes Ctrl+C, Ctrl+Break and SIGTERM into a flag the pipeline polls, so a session ends by
+// draining the tracker instead of killing the process mid-sample. A second signal exits at once.
+void InstallStopSignalHandlers();
+bool IsStopRequested();